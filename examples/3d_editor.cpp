@@ -1106,10 +1106,10 @@ int main(int,char**){
 
     // Scene objects list label
     mkLbl("lbl_scene",RP+4,py,RPW-8,18,"Scene Objects:",0); py+=20;
-    // We'll show a simple text list below
-    auto lbl_list=std::unique_ptr<UILabel>(new UILabel("lbl_objlist",Rect(RP+4,py,RPW-8,100),"(none)",true));
-    lbl_list->fgColor=Pal::DISABLED_TXT;
-    auto* pLblList=static_cast<UILabel*>(ctx.add(std::move(lbl_list)));
+    // Virtualized list: rows are pulled from app.objects on demand
+    auto* pObjList=static_cast<UIListView*>(ctx.add(Make::ListView("lst_objects",Rect(RP+4,py,RPW-8,100),ctx)));
+    pObjList->rowCount=[&]{ return (int)app.objects.size(); };
+    pObjList->rowData=[&](int i,ListRow& r){ r.text=app.objects[i]->name; };
 
     // Hint
     auto hint=std::unique_ptr<UILabel>(new UILabel("lbl_hint",Rect(RP+4,winH-100,RPW-8,90),
@@ -1135,11 +1135,12 @@ int main(int,char**){
         o->smooth=pCkSm->isChecked();
         markAll();ctx.needsRedraw=true;
     };
+    auto sldP1=ctx.ref<UISlider>("sld_p1"_wid);
     spP1->on(EventType::ValueChanged,[&](UIComponent*,const UIEvent& e){
-        if(auto* sl=static_cast<UISlider*>(ctx.findById("sld_p1"))){sl->setValue(e.fvalue);sl->markDirty();}
+        if(auto* sl=sldP1.get()){sl->setValue(e.fvalue);sl->markDirty();}
         syncParamsToSelected();
     });
-    if(auto* sl=static_cast<UISlider*>(ctx.findById("sld_p1")))
+    if(auto* sl=sldP1.get())
         sl->on(EventType::ValueChanged,[&](UIComponent*,const UIEvent& e){spP1->setValue(e.fvalue);spP1->markDirty();syncParamsToSelected();});
     spP2->on(EventType::ValueChanged,[&](UIComponent*,const UIEvent&){syncParamsToSelected();});
     spP3->on(EventType::ValueChanged,[&](UIComponent*,const UIEvent&){syncParamsToSelected();});
@@ -1161,22 +1162,24 @@ int main(int,char**){
         spSU->setValue((float)o->segsU);spSU->markDirty();
         spSV->setValue((float)o->segsV);spSV->markDirty();
         pCkSm->setChecked(o->smooth);
-        if(auto* sl=static_cast<UISlider*>(ctx.findById("sld_p1"))){sl->setValue(o->radius);sl->markDirty();}
+        if(auto* sl=sldP1.get()){sl->setValue(o->radius);sl->markDirty();}
         pTxtN->setText(o->name);
         ctx.needsRedraw=true;
     };
 
-    // Update scene object list label
+    // Sync scene object list with app.objects / selection
     auto updateSceneList=[&](){
-        std::string txt;
-        for(auto& op:app.objects){
-            bool sel=(op->id==app.selectedId);
-            if(sel)txt+="► ";
-            txt+=op->name+"\n";
-        }
-        if(txt.empty())txt="(no objects)";
-        pLblList->setText(txt);
+        pObjList->refresh();
+        int row=-1;
+        for(int i=0;i<(int)app.objects.size();i++) if(app.objects[i]->id==app.selectedId){row=i;break;}
+        if(row>=0) pObjList->select(row); else { pObjList->clearSelection(); pObjList->current=-1; }
     };
+    pObjList->on(EventType::ValueChanged,[&](UIComponent*,const UIEvent& e){
+        if(e.ivalue<0||e.ivalue>=(int)app.objects.size())return;
+        app.selectedId=app.objects[e.ivalue]->id;
+        loadParamsFromSelected();app.statusMsg="Selected: "+app.selected()->name;
+        markAll();
+    });
 
     // ── VP find helper ───────────────────────────────────────────────
     auto vpUnder=[&](int mx,int my)->int{
@@ -1222,7 +1225,7 @@ int main(int,char**){
             {"lbl_name", 6,378, 52,18},{"txt_name",62,378,RPW-68,18},
             {"btn_create",4,402,RPW-8,22},
             {"lbl_scene", 4,430,RPW-8,18},
-            {"lbl_objlist",4,450,RPW-8,100},
+            {"lst_objects",4,450,RPW-8,100},
             {"lbl_hint", 4,winH-120,RPW-8,110},
         };
         for(auto& e:es)if(auto* c=ctx.findById(e.id))c->setRect(Rect(RP+e.rx,e.ry,e.w,e.h));
@@ -1236,10 +1239,13 @@ int main(int,char**){
     };
 
     // ── MAIN LOOP ───────────────────────────────────────────────────
+    // Orbit/pan drags repaint a viewport per motion: fold each frame's
+    // motion (and wheel) runs into one event first
+    InputCoalescer input;
     bool running=true;
     while(running){
-        SDL_Event ev;
-        while(SDL_PollEvent(&ev)){
+        input.poll();
+        for(SDL_Event& ev: input.events){
             // Context menu
             if(ctxMenu.open){
                 if(ev.type==SDL_MOUSEMOTION){int ni=ctxMenu.itemAt(ev.motion.x,ev.motion.y);if(ni!=ctxMenu.hovered){ctxMenu.hovered=ni;ctx.needsRedraw=true;}continue;}
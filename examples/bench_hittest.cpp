@@ -0,0 +1,94 @@
+/*
+ * bench_hittest.cpp  –  Coste del hit-testing según el número de widgets
+ *
+ * Construye N botones (la mitad sueltos en la raíz y la otra mitad dentro de
+ * paneles) y mide cuánto tarda UIContext::processEvent en atender un
+ * SDL_MOUSEMOTION en posiciones aleatorias. Como referencia se mide también
+ * un recorrido lineal de todo el árbol, que es lo que hacía el hit-test antes
+ * del índice espacial (HitGrid).
+ *
+ * No abre ventana: el contexto se inicializa sin renderer.
+ *
+ * Build (Linux):
+ *   g++ -std=c++11 -O2 examples/bench_hittest.cpp -o bench_hittest -I./include $(sdl2-config --cflags --libs)
+ */
+
+#include "winxp_ui.hpp"
+#include <chrono>
+
+using namespace WXUI;
+
+static const int W = 1920, H = 1080;
+
+// Recorrido completo, sin índice
+static UIComponent* linearHit(UIComponent* c, int x, int y) {
+    int cx = x, cy = y;
+    if (c->mapToChildSpace(cx, cy))
+        for (int i = (int)c->children.size() - 1; i >= 0; i--) {
+            UIComponent* ch = c->children[i].get();
+            if (!ch->visible || !ch->enabled) continue;
+            if (UIComponent* r = linearHit(ch, cx, cy)) return r;
+        }
+    return c->hitTest(x, y) ? c : nullptr;
+}
+
+static double nowUs() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void run(int n) {
+    UIContext ctx;
+    ctx.init(nullptr, W, H);
+
+    // Mitad en la raíz
+    int loose = n / 2;
+    for (int i = 0; i < loose; i++) {
+        char id[32]; std::snprintf(id, sizeof(id), "b%d", i);
+        int x = std::rand() % (W - 60), y = std::rand() % (H - 20);
+        ctx.add(Make::Button(id, Rect(x, y, 60, 20), "b"));
+    }
+    // Mitad repartida en paneles de 64 hijos
+    int nested = n - loose;
+    for (int p = 0; nested > 0; p++) {
+        char id[32]; std::snprintf(id, sizeof(id), "p%d", p);
+        int pw = 400, ph = 300;
+        UIComponent* panel = ctx.add(Make::Panel(id, Rect(std::rand() % (W - pw), std::rand() % (H - ph), pw, ph)));
+        for (int i = 0; i < 64 && nested > 0; i++, nested--) {
+            char cid[48]; std::snprintf(cid, sizeof(cid), "p%d_%d", p, i);
+            panel->addChild(Make::Button(cid, Rect(std::rand() % (pw - 40), std::rand() % (ph - 16), 40, 16), "c"), ctx);
+        }
+    }
+
+    const int EVENTS = 20000;
+    std::vector<std::pair<int,int>> pts(EVENTS);
+    for (auto& p : pts) p = std::make_pair(std::rand() % W, std::rand() % H);
+
+    SDL_Event ev; std::memset(&ev, 0, sizeof(ev));
+    ev.type = SDL_MOUSEMOTION;
+    ev.motion.x = 0; ev.motion.y = 0;
+    ctx.processEvent(ev);                      // construye los índices
+
+    double t0 = nowUs();
+    for (auto& p : pts) { ev.motion.x = p.first; ev.motion.y = p.second; ctx.processEvent(ev); }
+    double indexed = (nowUs() - t0) / EVENTS;
+
+    volatile size_t sink = 0;
+    t0 = nowUs();
+    for (auto& p : pts) {
+        for (int i = (int)ctx.widgets.size() - 1; i >= 0; i--) {
+            UIComponent* w = ctx.widgets[i].get();
+            if (!w->visible || !w->enabled) continue;
+            if (UIComponent* r = linearHit(w, p.first, p.second)) { sink += (size_t)r; break; }
+        }
+    }
+    double linear = (nowUs() - t0) / EVENTS;
+
+    std::printf("%8d widgets   processEvent %8.2f us   recorrido lineal %8.2f us\n", n, indexed, linear);
+}
+
+int main(int, char**) {
+    std::srand(1);
+    for (int n : { 100, 1000, 5000, 20000, 50000 }) run(n);
+    return 0;
+}
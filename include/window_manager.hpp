@@ -110,9 +110,12 @@ public:
         return m_ctx.add(std::move(c));
     }
 
-    UIComponent* find(const std::string& id) {
-        return m_ctx.findById(id);
-    }
+    UIComponent* find(StrRef id)   { return m_ctx.findById(id); }
+    UIComponent* find(WidgetId id) { return m_ctx.findById(id); }
+
+    // Handle tipado que resuelve por índice (ver UIContext::ref)
+    template<class T> WidgetRef<T> ref(StrRef id)   { return m_ctx.ref<T>(id); }
+    template<class T> WidgetRef<T> ref(WidgetId id) { return m_ctx.ref<T>(id); }
 
     // ── Callbacks ────────────────────────────────────────────────────────
     // Se llama UNA VEZ por evento SDL crudo (antes de procesarlo el UIContext).
@@ -127,10 +130,20 @@ public:
     Application& onFrame (FrameCB  cb) { m_onFrame  = std::move(cb); return *this; }
     Application& onResize(ResizeCB cb) { m_onResize = std::move(cb); return *this; }
 
+    // Opcional: antes de despachar, junta los SDL_MOUSEMOTION consecutivos
+    // de un frame en uno solo (última posición, xrel/yrel acumulados) y lo
+    // mismo con SDL_MOUSEWHEEL. Botones y teclas conservan su orden.
+    // onEvent recibe los eventos ya combinados.
+    Application& coalesceInput(bool on = true) { m_coalesce = on; return *this; }
+
     // ── run() ────────────────────────────────────────────────────────────
     // Inicia el bucle principal; regresa cuando el usuario cierra la ventana
     // o algún callback pone running = false.
     // `targetFPS` controla la velocidad del bucle (0 = sin límite).
+    // Sin onFrame el bucle no hace polling: duerme hasta el siguiente evento,
+    // el siguiente timer de ctx() (setTimeout/setInterval) o un
+    // postInvalidate desde otro hilo. Mientras haya animaciones en curso
+    // avanza a targetFPS y vuelve a dormir en cuanto terminan.
     void run(int targetFPS = 60) {
         if (!m_ok) return;
 
@@ -142,48 +155,36 @@ public:
 
             // ── Procesar eventos ────────────────────────────────────────
             SDL_Event ev;
-            while (SDL_PollEvent(&ev)) {
-
-                if (ev.type == SDL_QUIT) {
-                    running = false;
-                    break;
-                }
-
-                // Resize nativo
-                if (ev.type == SDL_WINDOWEVENT &&
-                    (ev.window.event == SDL_WINDOWEVENT_RESIZED ||
-                     ev.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
-                {
-                    m_w = ev.window.data1;
-                    m_h = ev.window.data2;
-                    m_ctx.resize(m_w, m_h);
-                    if (m_onResize) m_onResize(m_w, m_h);
-                    continue;
-                }
-
-                // Callback de usuario (puede consumir el evento)
-                if (m_onEvent) {
-                    m_onEvent(ev, running);
-                    if (!running) break;
-                }
-
-                // UIContext procesa el resto
-                m_ctx.processEvent(ev);
+            m_input.clear();
+            if (!m_onFrame && !m_ctx.isAnimating()) {
+                int wait = m_ctx.msUntilNextTimer();
+                bool got = (wait < 0) ? SDL_WaitEvent(&ev) != 0
+                                      : SDL_WaitEventTimeout(&ev, wait) != 0;
+                if (got) dispatchEvent(ev, running);
             }
+            while (running && SDL_PollEvent(&ev))
+                dispatchEvent(ev, running);
+            for (size_t i = 0; running && i < m_input.events.size(); i++)
+                handleEvent(m_input.events[i], running);
 
             if (!running) break;
 
             // ── Lógica por frame ────────────────────────────────────────
             if (m_onFrame) m_onFrame();
 
-            // ── Render ─────────────────────────────────────────────────
+            // ── Render (despacha también los timers vencidos) ──────────
             m_ctx.render();
 
             // ── Frame cap ──────────────────────────────────────────────
+            // Nunca se duerme más allá del siguiente timer
             if (frameMs > 0) {
                 Uint32 elapsed = SDL_GetTicks() - frameStart;
-                if (elapsed < frameMs)
-                    SDL_Delay(frameMs - elapsed);
+                if (elapsed < frameMs) {
+                    Uint32 delay = frameMs - elapsed;
+                    int next = m_ctx.msUntilNextTimer();
+                    if (next >= 0 && (Uint32)next < delay) delay = (Uint32)next;
+                    SDL_Delay(delay);
+                }
             }
         }
     }
@@ -205,9 +206,45 @@ public:
     void invalidate() { m_ctx.needsRedraw = true; }
 
 private:
+    // Con coalesceInput() el evento espera en m_input hasta final del drenado
+    void dispatchEvent(SDL_Event& ev, bool& running) {
+        if (m_coalesce) m_input.push(ev);
+        else            handleEvent(ev, running);
+    }
+
+    void handleEvent(SDL_Event& ev, bool& running) {
+        if (ev.type == SDL_QUIT) {
+            running = false;
+            return;
+        }
+
+        // Resize nativo
+        if (ev.type == SDL_WINDOWEVENT &&
+            (ev.window.event == SDL_WINDOWEVENT_RESIZED ||
+             ev.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
+        {
+            m_w = ev.window.data1;
+            m_h = ev.window.data2;
+            m_ctx.resize(m_w, m_h);
+            if (m_onResize) m_onResize(m_w, m_h);
+            return;
+        }
+
+        // Callback de usuario (puede consumir el evento)
+        if (m_onEvent) {
+            m_onEvent(ev, running);
+            if (!running) return;
+        }
+
+        // UIContext procesa el resto
+        m_ctx.processEvent(ev);
+    }
+
     std::string   m_title;
     int           m_w, m_h;
     bool          m_ok   = false;
+    bool          m_coalesce = false;
+    InputCoalescer m_input;
 
     SDL_Window*   m_win  = nullptr;
     SDL_Renderer* m_ren  = nullptr;
@@ -9,12 +9,45 @@
 #include <vector>
 #include <unordered_map>
 #include <functional>
+#include <type_traits>
+#include <new>
 #include <memory>
 #include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <cmath>
+#include <cstdint>
+#include <cctype>
+#include <climits>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <deque>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define WXUI_SSE2 1
+#endif
 
 namespace WXUI {
 
@@ -120,6 +153,464 @@ static const uint8_t g_font8x8[96][8] = {
 /*127 DEL */ {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF},
 };
 
+// ═══════════════════════════════════════════════════════════════════════════
+//  SECTION 1b – Font: packed glyph atlas, advances, kerning, cached metrics
+// ═══════════════════════════════════════════════════════════════════════════
+namespace Utf8 {
+
+// Decode the code point starting at s[i] and advance i past it.
+// Malformed or truncated sequences yield U+FFFD and consume one byte.
+inline uint32_t decode(const char* s, size_t n, size_t& i) {
+    unsigned char c=(unsigned char)s[i];
+    if(c<0x80){ i++; return c; }
+    int len= c>=0xF0&&c<0xF5 ? 4 : c>=0xE0&&c<0xF0 ? 3 : c>=0xC2&&c<0xE0 ? 2 : 0;
+    if(!len||i+len>n){ i++; return 0xFFFD; }
+    uint32_t cp= len==2 ? c&0x1F : len==3 ? c&0x0F : c&0x07;
+    for(int k=1;k<len;k++){
+        unsigned char cc=(unsigned char)s[i+k];
+        if((cc&0xC0)!=0x80){ i++; return 0xFFFD; }
+        cp=(cp<<6)|(cc&0x3F);
+    }
+    if((len==3&&cp<0x800)||(len==4&&(cp<0x10000||cp>0x10FFFF))||(cp>=0xD800&&cp<=0xDFFF)){
+        i++; return 0xFFFD;
+    }
+    i+=len;
+    return cp;
+}
+
+// Byte index of the code point after / before the boundary at i
+inline size_t next(const std::string& s, size_t i) {
+    if(i>=s.size()) return s.size();
+    decode(s.data(),s.size(),i);
+    return i;
+}
+inline size_t prev(const std::string& s, size_t i) {
+    if(i==0) return 0;
+    size_t j=std::min(i,s.size())-1;
+    while(j>0&&((unsigned char)s[j]&0xC0)==0x80&&i-j<4) j--;
+    size_t k=j; decode(s.data(),s.size(),k);
+    return k==i?j:i-1;
+}
+
+// Number of code points decode() yields over s[0,n)
+inline size_t count(const char* s, size_t n) {
+    size_t c=0;
+    for(size_t i=0;i<n;c++){
+        if((unsigned char)s[i]<0x80) i++;
+        else decode(s,n,i);
+    }
+    return c;
+}
+
+} // namespace Utf8
+
+// Read-only memory mapping of a whole file (POSIX mmap / Win32 file mapping)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&)=delete;
+    MappedFile& operator=(const MappedFile&)=delete;
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        hFile=CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL,nullptr);
+        if(hFile==INVALID_HANDLE_VALUE){ hFile=nullptr; return false; }
+        LARGE_INTEGER sz; GetFileSizeEx(hFile,&sz);
+        len=(size_t)sz.QuadPart;
+        hMap=CreateFileMappingA(hFile,nullptr,PAGE_READONLY,0,0,nullptr);
+        if(hMap) ptr=(const uint8_t*)MapViewOfFile(hMap,FILE_MAP_READ,0,0,0);
+#else
+        int fd=::open(path.c_str(),O_RDONLY);
+        if(fd<0) return false;
+        struct stat st;
+        if(fstat(fd,&st)==0&&st.st_size>0){
+            len=(size_t)st.st_size;
+            void* m=mmap(nullptr,len,PROT_READ,MAP_PRIVATE,fd,0);
+            if(m!=MAP_FAILED) ptr=(const uint8_t*)m;
+        }
+        ::close(fd);
+#endif
+        if(!ptr){ close(); return false; }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if(ptr)   UnmapViewOfFile(ptr);
+        if(hMap)  CloseHandle(hMap);
+        if(hFile) CloseHandle(hFile);
+        hMap=hFile=nullptr;
+#else
+        if(ptr) munmap((void*)ptr,len);
+#endif
+        ptr=nullptr; len=0;
+    }
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const uint8_t* ptr=nullptr;
+    size_t len=0;
+#ifdef _WIN32
+    HANDLE hFile=nullptr, hMap=nullptr;
+#endif
+};
+
+struct Glyph {
+    uint16_t ax=0, ay=0;      // top-left in the atlas
+    uint8_t  w=0, h=0;        // bitmap size
+    int8_t   left=0, top=0;   // bitmap offset from pen position / line top
+    uint8_t  advance=0;
+    bool     present=false;
+};
+
+class Font {
+public:
+    int lineHeight=8;         // text row height used for vertical centering
+    int ascent=8;
+
+    Font() = default;
+    Font(const Font&)=delete;
+    Font& operator=(const Font&)=delete;
+
+    // The embedded 8×8 font; default for every widget.
+    static Font& builtin() {
+        static Font f;
+        if(!f.loaded){
+            f.lineHeight=8; f.ascent=8; f.fallbackAdvance=8;
+            for(int i=0;i<96;i++){
+                Glyph& g=f.slot(32+i);
+                f.pack(g,8,8);
+                for(int row=0;row<8;row++)
+                    for(int col=0;col<8;col++)
+                        f.atlas[(g.ay+row)*ATLAS_W+g.ax+col]=(g_font8x8[i][row]>>(7-col))&1;
+                g.advance=8; g.present=true;
+            }
+            f.loaded=true;
+        }
+        return f;
+    }
+
+    // Font used by Draw:: text functions and widget metrics.
+    static Font& active() { Font* f=activePtr(); return f?*f:builtin(); }
+    static void setActive(Font* f) { activePtr()=f; }
+
+    // ── Glyph access ─────────────────────────────────────────────────────
+    const Glyph* glyph(uint32_t cp) const {
+        const Page* p=page(cp>>8);
+        if(!p) return nullptr;
+        const Glyph& g=p->g[cp&0xFF];
+        return g.present?&g:nullptr;
+    }
+    int advance(uint32_t cp) const {
+        const Glyph* g=glyph(cp);
+        return g?g->advance:fallbackAdvance;
+    }
+    int kerning(uint32_t a, uint32_t b) const {
+        if(kern.empty()) return 0;
+        auto it=kern.find(((uint64_t)a<<32)|b);
+        return it!=kern.end()?it->second:0;
+    }
+    void setKerning(uint32_t a, uint32_t b, int dx) {
+        kern[((uint64_t)a<<32)|b]=(int8_t)dx;
+        widthCache.clear();
+    }
+    const uint8_t* atlasData() const { return atlas.data(); }
+    int atlasWidth()  const { return ATLAS_W; }
+    int atlasHeight() const { return (int)atlas.size()/ATLAS_W; }
+
+    // ── Metrics ──────────────────────────────────────────────────────────
+    // Width of n bytes of UTF-8 text (pen advance incl. kerning), uncached.
+    int measure(const char* s, size_t n) const {
+        if(mono&&kern.empty()) return (int)Utf8::count(s,n)*fallbackAdvance;
+        int w=0; uint32_t prev=0;
+        for(size_t i=0;i<n;){
+            bool first=i==0;
+            uint32_t cp=Utf8::decode(s,n,i);
+            if(!first) w+=kerning(prev,cp);
+            w+=advance(cp); prev=cp;
+        }
+        return w;
+    }
+
+    // Width of a whole string; proportional fonts cache results by string hash.
+    int measureText(const std::string& s) const {
+        if(mono&&kern.empty()) return (int)Utf8::count(s.data(),s.size())*fallbackAdvance;
+        uint64_t h=hashBytes(s.data(),s.size());
+        auto it=widthCache.find(h);
+        if(it!=widthCache.end()) return it->second;
+        if(widthCache.size()>=MAX_CACHE) widthCache.clear();
+        int w=measure(s.data(),s.size());
+        widthCache[h]=w;
+        return w;
+    }
+
+    // Byte index of the code point boundary nearest to pixel offset x.
+    size_t indexAt(const std::string& s, int x) const {
+        int pen=0; uint32_t prev=0;
+        for(size_t i=0;i<s.size();){
+            size_t at=i;
+            uint32_t cp=Utf8::decode(s.data(),s.size(),i);
+            if(at) pen+=kerning(prev,cp);
+            int adv=advance(cp);
+            if(x<pen+adv/2) return at;
+            pen+=adv; prev=cp;
+        }
+        return s.size();
+    }
+
+    // ── Loading ──────────────────────────────────────────────────────────
+    // Load a BDF bitmap font into this instance's atlas.
+    bool loadBDF(const std::string& path) {
+        FILE* f=fopen(path.c_str(),"rb");
+        if(!f) return false;
+        reset();
+        char line[512];
+        int fbbH=0, fbbY=0, asc=-1, desc=-1;
+        long enc=-1; int dw=0, bw=0, bh=0, bx=0, by=0;
+        bool inBitmap=false; int row=0;
+        std::vector<uint8_t> bits;
+        while(fgets(line,sizeof(line),f)){
+            if(inBitmap){
+                if(!strncmp(line,"ENDCHAR",7)){
+                    inBitmap=false;
+                    if(enc>=0&&enc<=0x10FFFF) addGlyph((uint32_t)enc,bw,bh,bx,by,dw,bits.data());
+                    continue;
+                }
+                if(row<bh){
+                    int bytes=(bw+7)/8;
+                    for(int col=0;col<bw;col++){
+                        int byteIdx=col/8;
+                        if(byteIdx>=bytes) break;
+                        unsigned v=0; sscanf(line+byteIdx*2,"%2x",&v);
+                        bits[row*bw+col]=(v>>(7-col%8))&1;
+                    }
+                    row++;
+                }
+                continue;
+            }
+            if(!strncmp(line,"FONTBOUNDINGBOX",15)){ int w0,x0; sscanf(line+15,"%d %d %d %d",&w0,&fbbH,&x0,&fbbY); }
+            else if(!strncmp(line,"FONT_ASCENT",11))  sscanf(line+11,"%d",&asc);
+            else if(!strncmp(line,"FONT_DESCENT",12)) sscanf(line+12,"%d",&desc);
+            else if(!strncmp(line,"STARTCHAR",9)){ enc=-1; dw=0; bw=bh=bx=by=0; }
+            else if(!strncmp(line,"ENCODING",8))  sscanf(line+8,"%ld",&enc);
+            else if(!strncmp(line,"DWIDTH",6))    sscanf(line+6,"%d",&dw);
+            else if(!strncmp(line,"BBX",3))       sscanf(line+3,"%d %d %d %d",&bw,&bh,&bx,&by);
+            else if(!strncmp(line,"BITMAP",6)){
+                inBitmap=true; row=0;
+                bits.assign((size_t)std::max(0,bw*bh),0);
+            }
+            else if(!strncmp(line,"CHARS ",6)){
+                if(asc<0){ asc=fbbH+fbbY; desc=-fbbY; }
+                pendingAscent=asc;
+            }
+        }
+        fclose(f);
+        if(asc<0){ asc=fbbH+fbbY; desc=-fbbY; }
+        finishLoad(asc,desc);
+        return loaded;
+    }
+
+    // ── Paged binary font file ("WXF1") ──────────────────────────────────
+    // Layout (little-endian):
+    //   header   : "WXF1" u16 lineHeight u16 ascent u16 fallbackAdvance u16 flags
+    //              u32 pageCount u32 kernCount
+    //   directory: pageCount × { u32 page (codepoint>>8), u32 offset, u32 size }, sorted
+    //   kerning  : kernCount × { u32 a, u32 b, i32 dx }
+    //   page blob: 256 × { u8 w, u8 h, i8 left, i8 top, u8 advance, u8 present }
+    //              followed by 1-bpp rows ((w+7)/8 bytes each) of present glyphs
+    // The file stays memory-mapped; a page is decoded into the atlas the first
+    // time one of its code points is looked up.
+    bool loadPaged(const std::string& path) {
+        reset();
+        if(!file.open(path)) return false;
+        const uint8_t* d=file.data(); size_t n=file.size();
+        if(n<20||memcmp(d,"WXF1",4)){ file.close(); return false; }
+        lineHeight=rd16(d+4); ascent=rd16(d+6); fallbackAdvance=rd16(d+8);
+        mono=(rd16(d+10)&1)!=0;
+        uint32_t pc=rd32(d+12), kc=rd32(d+16);
+        size_t dirOff=20, kernOff=dirOff+(size_t)pc*12;
+        if(kernOff+(size_t)kc*12>n){ file.close(); return false; }
+        directory.resize(pc);
+        for(uint32_t i=0;i<pc;i++){
+            const uint8_t* e=d+dirOff+i*12;
+            directory[i]={rd32(e),rd32(e+4),rd32(e+8)};
+        }
+        for(uint32_t i=0;i<kc;i++){
+            const uint8_t* e=d+kernOff+i*12;
+            kern[((uint64_t)rd32(e)<<32)|rd32(e+4)]=(int8_t)(int32_t)rd32(e+8);
+        }
+        loaded=true;
+        return true;
+    }
+
+    // Write every decoded page of this font in the paged format.
+    bool savePaged(const std::string& path) const {
+        for(auto& de: directory) page(de.page);
+        std::vector<uint32_t> idx;
+        for(auto& kv: pages)
+            for(auto& g: kv.second->g) if(g.present){ idx.push_back(kv.first); break; }
+        std::sort(idx.begin(),idx.end());
+        std::vector<uint8_t> out;
+        auto w16=[&](uint32_t v){ out.push_back(v&0xFF); out.push_back((v>>8)&0xFF); };
+        auto w32=[&](uint32_t v){ w16(v&0xFFFF); w16(v>>16); };
+        out.insert(out.end(),{'W','X','F','1'});
+        w16(lineHeight); w16(ascent); w16(fallbackAdvance); w16(mono?1:0);
+        w32((uint32_t)idx.size()); w32((uint32_t)kern.size());
+        size_t dirAt=out.size();
+        out.resize(out.size()+idx.size()*12);
+        for(auto& kv: kern){ w32((uint32_t)(kv.first>>32)); w32((uint32_t)kv.first); w32((uint32_t)(int32_t)kv.second); }
+        for(size_t i=0;i<idx.size();i++){
+            const Page* pg=page(idx[i]);
+            size_t off=out.size();
+            for(auto& g: pg->g){
+                out.push_back(g.w); out.push_back(g.h); out.push_back((uint8_t)g.left);
+                out.push_back((uint8_t)g.top); out.push_back(g.advance); out.push_back(g.present);
+            }
+            for(auto& g: pg->g){
+                if(!g.present) continue;
+                for(int r=0;r<g.h;r++){
+                    const uint8_t* src=atlas.data()+(g.ay+r)*ATLAS_W+g.ax;
+                    for(int b=0;b<(g.w+7)/8;b++){
+                        uint8_t v=0;
+                        for(int c=0;c<8&&b*8+c<g.w;c++) if(src[b*8+c]) v|=0x80>>c;
+                        out.push_back(v);
+                    }
+                }
+            }
+            uint8_t* e=out.data()+dirAt+i*12;
+            uint32_t vals[3]={idx[i],(uint32_t)off,(uint32_t)(out.size()-off)};
+            for(int k=0;k<3;k++) for(int b=0;b<4;b++) e[k*4+b]=(vals[k]>>(8*b))&0xFF;
+        }
+        FILE* f=fopen(path.c_str(),"wb");
+        if(!f) return false;
+        bool ok=fwrite(out.data(),1,out.size(),f)==out.size();
+        fclose(f);
+        return ok;
+    }
+
+    // Add one glyph from a w×h 0/1 bitmap. `bx,by` follow BDF conventions
+    // (offset of the bitmap's bottom-left corner from the pen on the baseline).
+    void addGlyph(uint32_t cp, int w, int h, int bx, int by, int adv, const uint8_t* bits) {
+        Glyph& g=slot(cp);
+        w=std::max(0,std::min(255,w)); h=std::max(0,std::min(255,h));
+        pack(g,w,h);
+        for(int r=0;r<h;r++)
+            for(int c=0;c<w;c++)
+                atlas[(g.ay+r)*ATLAS_W+g.ax+c]=bits[r*w+c];
+        g.left=(int8_t)bx; g.top=(int8_t)(pendingAscent-(by+h));
+        g.advance=(uint8_t)std::max(0,std::min(255,adv)); g.present=true;
+        if(loaded){ if(g.advance!=fallbackAdvance) mono=false; widthCache.clear(); }
+        else pendingGlyphs.push_back(cp);
+    }
+
+protected:
+    struct Page { Glyph g[256]; };
+    struct DirEntry { uint32_t page, offset, size; };
+    static const int ATLAS_W=256;
+    static const size_t MAX_CACHE=4096;
+
+    // Glyph storage is filled lazily for paged fonts, hence mutable.
+    mutable std::vector<uint8_t> atlas;    // 1 byte per pixel, 0/1 coverage
+    mutable std::unordered_map<uint32_t, std::unique_ptr<Page>> pages;
+    mutable Page* page0=nullptr;           // fast path for Latin-1
+    MappedFile            file;            // paged font source (if any)
+    std::vector<DirEntry> directory;
+    std::unordered_map<uint64_t,int8_t>    kern;
+    mutable std::unordered_map<uint64_t,int> widthCache;
+    int    fallbackAdvance=8;
+    bool   mono=true;
+    bool   loaded=false;
+    mutable int shelfX=0, shelfY=0, shelfH=0;
+    int    pendingAscent=8;
+    std::vector<uint32_t> pendingGlyphs;
+
+    static Font*& activePtr() { static Font* p=nullptr; return p; }
+
+    static uint64_t hashBytes(const char* s, size_t n) {
+        uint64_t h=1469598103934665603ull;
+        for(size_t i=0;i<n;i++){ h^=(unsigned char)s[i]; h*=1099511628211ull; }
+        return h;
+    }
+
+    const Page* page(uint32_t idx) const {
+        if(idx==0&&page0) return page0;
+        auto it=pages.find(idx);
+        if(it!=pages.end()) return it->second.get();
+        return file.data()?decodePage(idx):nullptr;
+    }
+    Glyph& slot(uint32_t cp) const {
+        auto& p=pages[cp>>8];
+        if(!p){ p.reset(new Page()); if((cp>>8)==0) page0=p.get(); }
+        return p->g[cp&0xFF];
+    }
+
+    // First lookup into a mapped page: unpack its glyphs into the atlas.
+    // Pages absent from the file are remembered as empty so the search runs once.
+    const Page* decodePage(uint32_t idx) const {
+        auto de=std::lower_bound(directory.begin(),directory.end(),idx,
+            [](const DirEntry& e, uint32_t v){ return e.page<v; });
+        Page* pg=&*(pages[idx]=std::unique_ptr<Page>(new Page()));
+        if(idx==0) page0=pg;
+        if(de==directory.end()||de->page!=idx||(size_t)de->offset+de->size>file.size()
+           ||de->size<256*6) return pg;
+        const uint8_t* rec=file.data()+de->offset;
+        const uint8_t* bits=rec+256*6;
+        const uint8_t* end=file.data()+de->offset+de->size;
+        for(int i=0;i<256;i++,rec+=6){
+            if(!rec[5]) continue;
+            Glyph& g=pg->g[i];
+            int w=rec[0], h=rec[1], rb=(w+7)/8;
+            if(bits+(size_t)rb*h>end) break;
+            pack(g,w,h);
+            for(int r=0;r<h;r++,bits+=rb)
+                for(int c=0;c<w;c++)
+                    atlas[(g.ay+r)*ATLAS_W+g.ax+c]=(bits[c/8]>>(7-c%8))&1;
+            g.left=(int8_t)rec[2]; g.top=(int8_t)rec[3]; g.advance=rec[4]; g.present=true;
+        }
+        return pg;
+    }
+
+    static uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0]|(p[1]<<8)); }
+    static uint32_t rd32(const uint8_t* p) { return (uint32_t)rd16(p)|((uint32_t)rd16(p+2)<<16); }
+
+    // Shelf packer: glyphs fill rows left to right; the atlas grows downward.
+    void pack(Glyph& g, int w, int h) const {
+        if(shelfX+w>ATLAS_W){ shelfY+=shelfH; shelfX=0; shelfH=0; }
+        g.ax=(uint16_t)shelfX; g.ay=(uint16_t)shelfY; g.w=(uint8_t)w; g.h=(uint8_t)h;
+        shelfX+=w; shelfH=std::max(shelfH,h);
+        size_t need=(size_t)(shelfY+shelfH)*ATLAS_W;
+        if(atlas.size()<need) atlas.resize(need,0);
+    }
+
+    void reset() {
+        atlas.clear(); pages.clear(); page0=nullptr; kern.clear(); widthCache.clear();
+        file.close(); directory.clear();
+        shelfX=shelfY=shelfH=0; loaded=false; mono=true; pendingGlyphs.clear();
+        pendingAscent=8;
+    }
+
+    // BDF tops are known only relative to the final ascent; rebase at the end.
+    void finishLoad(int asc, int desc) {
+        int delta=asc-pendingAscent;
+        for(uint32_t cp: pendingGlyphs){ Glyph& g=slot(cp); g.top=(int8_t)(g.top+delta); }
+        pendingGlyphs.clear();
+        pendingAscent=asc;
+        ascent=asc; lineHeight=std::max(1,asc+std::max(0,desc));
+        const Glyph* sp=glyph(' ');
+        fallbackAdvance=sp?sp->advance:std::max(1,lineHeight/2);
+        mono=true;
+        for(auto& kv: pages)
+            for(auto& g: kv.second->g)
+                if(g.present&&g.advance!=fallbackAdvance) mono=false;
+        loaded=!pages.empty();
+    }
+};
+
 // ═══════════════════════════════════════════════════════════════════════════
 //  SECTION 2 – Color & Palette
 // ═══════════════════════════════════════════════════════════════════════════
@@ -128,6 +619,11 @@ struct Color {
     Color(uint8_t r=0,uint8_t g=0,uint8_t b=0,uint8_t a=255):r(r),g(g),b(b),a(a){}
     uint32_t pack(SDL_Surface* s) const { return SDL_MapRGBA(s->format,r,g,b,a); }
     bool operator==(const Color& o) const { return r==o.r&&g==o.g&&b==o.b&&a==o.a; }
+    // t=0 → this, t=1 → o
+    Color mix(const Color& o, float t) const {
+        auto ch=[t](uint8_t x, uint8_t y){ return (uint8_t)(x+(y-x)*t+0.5f); };
+        return Color(ch(r,o.r),ch(g,o.g),ch(b,o.b),ch(a,o.a));
+    }
 };
 
 namespace Pal {
@@ -156,6 +652,8 @@ namespace Pal {
     static const Color VP_BORDER_ON{255,200,  0};
     static const Color VP_BORDER_OFF{110,110,110};
     static const Color VP_LABEL    {200,200,200};
+    // Hover highlight (push buttons)
+    static const Color HOT         {248,179, 48};
     // Tooltip
     static const Color TIP_BG      {255,255,225};
     static const Color TIP_BORDER  {  0,  0,  0};
@@ -167,7 +665,8 @@ namespace Pal {
 namespace Draw {
 
 inline void setPixel(SDL_Surface* s, int x, int y, uint32_t c) {
-    if(x<0||y<0||x>=s->w||y>=s->h) return;
+    const SDL_Rect& k=s->clip_rect;   // whole surface unless SDL_SetClipRect narrowed it
+    if(x<k.x||y<k.y||x>=k.x+k.w||y>=k.y+k.h) return;
     ((uint32_t*)s->pixels)[y*(s->pitch/4)+x] = c;
 }
 inline uint32_t getPixel(SDL_Surface* s, int x, int y) {
@@ -244,35 +743,58 @@ inline void drawGradientH(SDL_Surface* s, int x, int y, int w, int h,
     }
 }
 
-// 8×8 bitmap text
+// Bitmap text through the active Font (the embedded 8×8 by default)
+inline int textWidth(const std::string& txt) { return Font::active().measureText(txt); }
+inline int textHeight() { return Font::active().lineHeight; }
+
+inline void drawGlyph(SDL_Surface* s, int x, int y, const Font& f, const Glyph* g,
+                      uint32_t fgP, uint32_t bgP, int adv, bool transparent_bg) {
+    if(!transparent_bg)
+        for(int row=0;row<f.lineHeight;row++)
+            for(int col=0;col<adv;col++) setPixel(s,x+col,y+row,bgP);
+    if(!g) return;
+    const uint8_t* a=f.atlasData()+g->ay*f.atlasWidth()+g->ax;
+    int gx=x+g->left, gy=y+g->top;
+    for(int row=0;row<g->h;row++,a+=f.atlasWidth())
+        for(int col=0;col<g->w;col++)
+            if(a[col]) setPixel(s,gx+col,gy+row,fgP);
+}
+
 inline void drawChar(SDL_Surface* s, int x, int y, char ch, Color fg, Color bg,
                      bool transparent_bg=true) {
-    int idx=(unsigned char)ch-32;
-    if(idx<0||idx>95) idx=0;
-    const uint8_t* glyph=g_font8x8[idx];
-    uint32_t fgP=fg.pack(s), bgP=bg.pack(s);
-    for(int row=0;row<8;row++)
-        for(int col=0;col<8;col++){
-            bool on=(glyph[row]>>(7-col))&1;
-            if(on)            setPixel(s,x+col,y+row,fgP);
-            else if(!transparent_bg) setPixel(s,x+col,y+row,bgP);
-        }
+    const Font& f=Font::active();
+    uint32_t cp=(unsigned char)ch;
+    drawGlyph(s,x,y,f,f.glyph(cp),fg.pack(s),bg.pack(s),f.advance(cp),transparent_bg);
+}
+
+inline void drawCodepoint(SDL_Surface* s, int x, int y, uint32_t cp, Color fg, Color bg,
+                          bool transparent_bg=true) {
+    const Font& f=Font::active();
+    drawGlyph(s,x,y,f,f.glyph(cp),fg.pack(s),bg.pack(s),f.advance(cp),transparent_bg);
 }
 
+// UTF-8 text
 inline void drawText(SDL_Surface* s, int x, int y, const std::string& txt,
                      Color fg, Color bg={0,0,0}, bool transparent=true) {
-    int cx=x;
-    for(char c: txt){
-        drawChar(s,cx,y,c,fg,bg,transparent);
-        cx+=8;
+    const Font& f=Font::active();
+    uint32_t fgP=fg.pack(s), bgP=bg.pack(s);
+    int cx=x; uint32_t prev=0;
+    for(size_t i=0;i<txt.size();){
+        bool first=i==0;
+        uint32_t cp=Utf8::decode(txt.data(),txt.size(),i);
+        if(!first) cx+=f.kerning(prev,cp);
+        if(cx>=s->clip_rect.x+s->clip_rect.w) break;
+        int adv=f.advance(cp);
+        drawGlyph(s,cx,y,f,f.glyph(cp),fgP,bgP,adv,transparent);
+        cx+=adv; prev=cp;
     }
 }
 
 // Draw text centered in a rect
 inline void drawTextCentered(SDL_Surface* s, int rx, int ry, int rw, int rh,
                               const std::string& txt, Color fg) {
-    int tw=(int)txt.size()*8;
-    int th=8;
+    int tw=textWidth(txt);
+    int th=textHeight();
     int ox=rx+(rw-tw)/2;
     int oy=ry+(rh-th)/2;
     drawText(s,ox,oy,txt,fg);
@@ -281,7 +803,7 @@ inline void drawTextCentered(SDL_Surface* s, int rx, int ry, int rw, int rh,
 // Draw text left-aligned with padding
 inline void drawTextLeft(SDL_Surface* s, int rx, int ry, int rh,
                          const std::string& txt, Color fg, int padX=4) {
-    int oy=ry+(rh-8)/2;
+    int oy=ry+(rh-textHeight())/2;
     drawText(s,rx+padX,oy,txt,fg);
 }
 
@@ -319,6 +841,362 @@ inline void drawArrowRight(SDL_Surface* s, int x, int y, int size, Color c) {
 
 } // namespace Draw
 
+// ═══════════════════════════════════════════════════════════════════════════
+//  SECTION 3b – Vector Rasterizer (paths, strokes, scanline coverage fill)
+// ═══════════════════════════════════════════════════════════════════════════
+namespace Draw {
+
+enum class FillRule { NonZero, EvenOdd };
+
+struct PointF {
+    float x,y;
+    PointF(float x_=0.f,float y_=0.f): x(x_),y(y_){}
+};
+
+// Flattened vector path: curves are subdivided into line segments on insertion
+// (tolerance in pixels), so the rasterizer only ever sees polygons.
+class Path {
+public:
+    struct Contour { int start, end; bool closed; };
+    std::vector<PointF>  pts;
+    std::vector<Contour> contours;
+    float tolerance=0.25f;
+
+    void clear(){ pts.clear(); contours.clear(); }
+    bool empty() const { return pts.empty(); }
+
+    Path& moveTo(float x,float y){
+        contours.push_back({(int)pts.size(),(int)pts.size(),false});
+        pts.push_back(PointF(x,y)); contours.back().end++;
+        return *this;
+    }
+    Path& lineTo(float x,float y){
+        if(contours.empty()||contours.back().closed) return moveTo(x,y);
+        pts.push_back(PointF(x,y)); contours.back().end++;
+        return *this;
+    }
+    Path& quadTo(float cx,float cy,float x,float y){
+        if(contours.empty()) moveTo(cx,cy);
+        PointF p0=pts.back();
+        float ddx=p0.x-2*cx+x, ddy=p0.y-2*cy+y;
+        int n=segments(0.25f*std::sqrt(ddx*ddx+ddy*ddy));
+        for(int i=1;i<=n;i++){
+            float t=float(i)/n, u=1.f-t;
+            lineTo(u*u*p0.x+2*u*t*cx+t*t*x, u*u*p0.y+2*u*t*cy+t*t*y);
+        }
+        return *this;
+    }
+    Path& cubicTo(float c1x,float c1y,float c2x,float c2y,float x,float y){
+        if(contours.empty()) moveTo(c1x,c1y);
+        PointF p0=pts.back();
+        float ax=p0.x-2*c1x+c2x, ay=p0.y-2*c1y+c2y;
+        float bx=c1x-2*c2x+x,    by=c1y-2*c2y+y;
+        float dd=std::max(ax*ax+ay*ay,bx*bx+by*by);
+        int n=segments(0.75f*std::sqrt(dd));
+        for(int i=1;i<=n;i++){
+            float t=float(i)/n, u=1.f-t;
+            float w0=u*u*u, w1=3*u*u*t, w2=3*u*t*t, w3=t*t*t;
+            lineTo(w0*p0.x+w1*c1x+w2*c2x+w3*x, w0*p0.y+w1*c1y+w2*c2y+w3*y);
+        }
+        return *this;
+    }
+    Path& close(){
+        if(!contours.empty()) contours.back().closed=true;
+        return *this;
+    }
+
+    // ── Shapes ───────────────────────────────────────────────────────────
+    Path& addPolygon(const PointF* p, int n, bool closed=true){
+        if(n<=0) return *this;
+        moveTo(p[0].x,p[0].y);
+        for(int i=1;i<n;i++) lineTo(p[i].x,p[i].y);
+        if(closed) close();
+        return *this;
+    }
+    Path& addRect(float x,float y,float w,float h){
+        moveTo(x,y); lineTo(x+w,y); lineTo(x+w,y+h); lineTo(x,y+h);
+        return close();
+    }
+    Path& addEllipse(float cx,float cy,float rx,float ry){
+        float r=std::max(std::fabs(rx),std::fabs(ry));
+        if(r<=0.f) return *this;
+        int n=8;
+        if(r>tolerance){
+            float a=std::acos(std::max(-1.f,1.f-tolerance/r));
+            n=std::max(8,std::min(1024,(int)std::ceil(6.2831853f/(2*a))));
+        }
+        for(int i=0;i<n;i++){
+            float t=6.2831853f*float(i)/n;
+            float x=cx+rx*std::cos(t), y=cy+ry*std::sin(t);
+            if(i==0) moveTo(x,y); else lineTo(x,y);
+        }
+        return close();
+    }
+    Path& addCircle(float cx,float cy,float r){ return addEllipse(cx,cy,r,r); }
+
+private:
+    int segments(float dd) const {
+        int n=(int)std::ceil(std::sqrt(dd/tolerance));
+        return std::max(1,std::min(256,n));
+    }
+};
+
+// ── Span back end (ARGB8888 rows) ─────────────────────────────────────────
+inline void fillSpan(uint32_t* d, int n, uint32_t c) {
+#ifdef WXUI_SSE2
+    while(n>0&&((uintptr_t)d&15)){ *d++=c; n--; }
+    __m128i v=_mm_set1_epi32((int)c);
+    for(;n>=16;n-=16,d+=16){
+        _mm_store_si128((__m128i*)d,v);     _mm_store_si128((__m128i*)(d+4),v);
+        _mm_store_si128((__m128i*)(d+8),v); _mm_store_si128((__m128i*)(d+12),v);
+    }
+    for(;n>=4;n-=4,d+=4) _mm_store_si128((__m128i*)d,v);
+#endif
+    while(n-->0) *d++=c;
+}
+
+// src-over of an opaque colour at constant alpha a (0..256)
+inline uint32_t blendPixel(uint32_t d, uint32_t c, unsigned a) {
+    unsigned ia=256-a;
+    uint32_t rb=(((c&0x00FF00FFu)*a+(d&0x00FF00FFu)*ia)>>8)&0x00FF00FFu;
+    uint32_t ag=((((c>>8)&0x00FF00FFu)*a+((d>>8)&0x00FF00FFu)*ia))&0xFF00FF00u;
+    return rb|ag;
+}
+
+inline void blendSpan(uint32_t* d, int n, uint32_t c, unsigned a) {
+    if(a>=256){ fillSpan(d,n,c); return; }
+    if(a==0) return;
+#ifdef WXUI_SSE2
+    __m128i zero=_mm_setzero_si128();
+    __m128i a16=_mm_set1_epi16((short)a), ia16=_mm_set1_epi16((short)(256-a));
+    __m128i src=_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)c),zero),a16);
+    for(;n>=4;n-=4,d+=4){
+        __m128i x=_mm_loadu_si128((const __m128i*)d);
+        __m128i lo=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x,zero),ia16),src),8);
+        __m128i hi=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x,zero),ia16),src),8);
+        _mm_storeu_si128((__m128i*)d,_mm_packus_epi16(lo,hi));
+    }
+#endif
+    for(;n>0;n--,d++) *d=blendPixel(*d,c,a);
+}
+
+// ── Scanline rasterizer ───────────────────────────────────────────────────
+// Sparse coverage accumulation: each sub-scanline deposits its spans as
+// coverage deltas into the cells it touches; the row is then resolved by
+// walking only the touched cells, emitting constant-coverage runs between
+// them through fillSpan/blendSpan.
+class Rasterizer {
+public:
+    static const int SUBSAMPLES=4;
+
+    void fill(SDL_Surface* s, const Path& p, Color c, FillRule rule=FillRule::NonZero,
+              bool aa=true) {
+        if(!s||p.empty()||c.a==0) return;
+        buildEdges(p,s->h);
+        if(edges.empty()) return;
+        int W=s->w;
+        if((int)delta.size()<W+2){ delta.assign(W+2,0); mark.assign(W+2,0); }
+        int ss=aa?SUBSAMPLES:1;
+        int unit=aa?(256*64)/ss:256*64;   // coverage units per sub-scanline (full = 256*64)
+        uint32_t col=(c.pack(s)&0x00FFFFFFu)|0xFF000000u;
+        std::sort(edges.begin(),edges.end(),[](const Edge& a,const Edge& b){ return a.y0<b.y0; });
+        int y0=std::max(0,(int)std::floor(yMin)), y1=std::min(s->h,(int)std::ceil(yMax));
+        size_t next=0; active.clear();
+        for(int y=y0;y<y1;y++){
+            for(int sub=0;sub<ss;sub++){
+                float sy=y+(sub+0.5f)/ss;
+                while(next<edges.size()&&edges[next].y0<=sy) active.push_back(edges[next++]);
+                xs.clear();
+                for(size_t i=0;i<active.size();){
+                    Edge& e=active[i];
+                    if(e.y1<=sy){ active[i]=active.back(); active.pop_back(); continue; }
+                    if(sy>=e.y0) xs.push_back(Crossing{e.x0+(sy-e.y0)*e.dxdy,e.dir});
+                    i++;
+                }
+                if(xs.size()<2) continue;
+                std::sort(xs.begin(),xs.end(),[](const Crossing& a,const Crossing& b){ return a.x<b.x; });
+                int wind=0;
+                for(size_t i=0;i+1<xs.size();i++){
+                    wind+=xs[i].dir;
+                    bool in=rule==FillRule::NonZero ? wind!=0 : (wind&1)!=0;
+                    if(in) span(xs[i].x,xs[i+1].x,W,unit,aa);
+                }
+            }
+            resolveRow(s,y,col,c.a);
+        }
+    }
+
+private:
+    struct Edge { float x0,y0,y1,dxdy; int dir; };
+    struct Crossing { float x; int dir; };
+    std::vector<Edge>     edges, active;
+    std::vector<Crossing> xs;
+    std::vector<int>      delta;   // coverage delta per cell (prefix-summed along the row)
+    std::vector<uint8_t>  mark;    // cell touched in the current row
+    std::vector<int>      cells;   // touched cells, unsorted
+    float yMin=0, yMax=0;
+
+    void buildEdges(const Path& p, int h) {
+        edges.clear(); yMin=1e30f; yMax=-1e30f;
+        for(auto& ct: p.contours){
+            int n=ct.end-ct.start;
+            if(n<2) continue;
+            for(int i=0;i<n;i++){
+                const PointF& a=p.pts[ct.start+i];
+                const PointF& b=p.pts[ct.start+(i+1)%n];
+                if(a.y==b.y) continue;
+                Edge e;
+                if(a.y<b.y){ e.x0=a.x; e.y0=a.y; e.y1=b.y; e.dir=1;  e.dxdy=(b.x-a.x)/(b.y-a.y); }
+                else       { e.x0=b.x; e.y0=b.y; e.y1=a.y; e.dir=-1; e.dxdy=(a.x-b.x)/(a.y-b.y); }
+                if(e.y1<=0.f||e.y0>=(float)h) continue;
+                yMin=std::min(yMin,e.y0); yMax=std::max(yMax,e.y1);
+                edges.push_back(e);
+            }
+        }
+    }
+
+    void touch(int x, int v) {
+        delta[x]+=v;
+        if(!mark[x]){ mark[x]=1; cells.push_back(x); }
+    }
+
+    // Deposit [xa,xb) with weight `unit`; partial end cells get fractional coverage.
+    void span(float xa, float xb, int W, int unit, bool aa) {
+        if(!aa){ xa=std::ceil(xa-0.5f); xb=std::ceil(xb-0.5f); }
+        xa=std::max(0.f,std::min((float)W,xa));
+        xb=std::max(0.f,std::min((float)W,xb));
+        if(xb<=xa) return;
+        int ia=(int)xa, ib=(int)xb;
+        if(ia==ib){
+            int v=(int)((xb-xa)*unit);
+            touch(ia,v); touch(ia+1,-v);
+            return;
+        }
+        int fa=(int)((ia+1-xa)*unit), fb=(int)((xb-ib)*unit);
+        touch(ia,fa); touch(ia+1,unit-fa);
+        touch(ib,fb-unit); touch(ib+1,-fb);
+    }
+
+    void resolveRow(SDL_Surface* s, int y, uint32_t col, uint8_t alpha) {
+        if(cells.empty()) return;
+        std::sort(cells.begin(),cells.end());
+        uint32_t* row=(uint32_t*)((uint8_t*)s->pixels+y*s->pitch);
+        int W=s->w, acc=0, prev=cells[0];
+        for(int x: cells){
+            if(acc>0&&x>prev) emit(row+prev,std::min(x,W)-prev,acc,col,alpha);
+            acc+=delta[x]; delta[x]=0; mark[x]=0;
+            prev=x;
+        }
+        cells.clear();
+    }
+
+    static void emit(uint32_t* d, int n, int cov, uint32_t col, uint8_t alpha) {
+        if(n<=0) return;
+        unsigned a=(unsigned)std::min(cov,256*64)>>6;      // 0..256
+        a=(a*(alpha+1))>>8;
+        blendSpan(d,n,col,a);
+    }
+};
+
+inline Rasterizer& sharedRasterizer() { static Rasterizer r; return r; }
+
+// Build a stroke outline for every contour of `p` (segment quads + round joins),
+// all wound the same way so a NonZero fill merges overlaps without seams.
+inline void strokeToPath(const Path& p, float width, Path& out, bool roundCaps=false) {
+    float hw=width*0.5f;
+    auto addOriented=[&](PointF* q, int n){
+        float area=0;
+        for(int i=0;i<n;i++){ const PointF& a=q[i]; const PointF& b=q[(i+1)%n]; area+=a.x*b.y-b.x*a.y; }
+        if(area<0) std::reverse(q,q+n);
+        out.addPolygon(q,n);
+    };
+    auto addDisc=[&](const PointF& c){
+        int first=(int)out.pts.size();
+        out.addCircle(c.x,c.y,hw);
+        if(out.pts.size()>=(size_t)first+3){
+            std::vector<PointF> tmp(out.pts.begin()+first,out.pts.end());
+            out.pts.resize(first); out.contours.pop_back();
+            addOriented(tmp.data(),(int)tmp.size());
+        }
+    };
+    for(auto& ct: p.contours){
+        int n=ct.end-ct.start;
+        int segs=ct.closed?n:n-1;
+        for(int i=0;i<segs;i++){
+            const PointF& a=p.pts[ct.start+i];
+            const PointF& b=p.pts[ct.start+(i+1)%n];
+            float dx=b.x-a.x, dy=b.y-a.y, len=std::sqrt(dx*dx+dy*dy);
+            if(len<1e-6f) continue;
+            float nx=-dy/len*hw, ny=dx/len*hw;
+            PointF q[4]={PointF(a.x+nx,a.y+ny),PointF(b.x+nx,b.y+ny),
+                         PointF(b.x-nx,b.y-ny),PointF(a.x-nx,a.y-ny)};
+            addOriented(q,4);
+        }
+        if(width>2.f){
+            int j0=ct.closed?0:1, j1=ct.closed?n:n-1;
+            for(int j=j0;j<j1;j++) addDisc(p.pts[ct.start+j]);
+        }
+        if(roundCaps&&!ct.closed&&n>=2){ addDisc(p.pts[ct.start]); addDisc(p.pts[ct.end-1]); }
+        if(n==1&&roundCaps) addDisc(p.pts[ct.start]);
+    }
+}
+
+// ── Convenience API ───────────────────────────────────────────────────────
+inline void fillPath(SDL_Surface* s, const Path& p, Color c,
+                     FillRule rule=FillRule::NonZero, bool aa=true) {
+    sharedRasterizer().fill(s,p,c,rule,aa);
+}
+
+inline void strokePath(SDL_Surface* s, const Path& p, Color c, float width=1.f,
+                       bool aa=true, bool roundCaps=false) {
+    Path outline;
+    strokeToPath(p,width,outline,roundCaps);
+    sharedRasterizer().fill(s,outline,c,FillRule::NonZero,aa);
+}
+
+inline void fillPolygon(SDL_Surface* s, const PointF* pts, int n, Color c,
+                        FillRule rule=FillRule::NonZero, bool aa=true) {
+    Path p; p.addPolygon(pts,n);
+    fillPath(s,p,c,rule,aa);
+}
+
+inline void drawLine(SDL_Surface* s, float x0, float y0, float x1, float y1, Color c,
+                     float width=1.f, bool aa=true) {
+    Path p; p.moveTo(x0,y0).lineTo(x1,y1);
+    strokePath(s,p,c,width,aa);
+}
+
+inline void fillEllipse(SDL_Surface* s, float cx, float cy, float rx, float ry, Color c,
+                        bool aa=true) {
+    Path p; p.addEllipse(cx,cy,rx,ry);
+    fillPath(s,p,c,FillRule::NonZero,aa);
+}
+inline void drawEllipse(SDL_Surface* s, float cx, float cy, float rx, float ry, Color c,
+                        float width=1.f, bool aa=true) {
+    Path p; p.addEllipse(cx,cy,rx,ry);
+    strokePath(s,p,c,width,aa);
+}
+inline void fillCircle(SDL_Surface* s, float cx, float cy, float r, Color c, bool aa=true) {
+    fillEllipse(s,cx,cy,r,r,c,aa);
+}
+inline void drawCircle(SDL_Surface* s, float cx, float cy, float r, Color c,
+                       float width=1.f, bool aa=true) {
+    drawEllipse(s,cx,cy,r,r,c,width,aa);
+}
+
+inline void drawQuadBezier(SDL_Surface* s, PointF p0, PointF c0, PointF p1, Color c,
+                           float width=1.f, bool aa=true) {
+    Path p; p.moveTo(p0.x,p0.y).quadTo(c0.x,c0.y,p1.x,p1.y);
+    strokePath(s,p,c,width,aa);
+}
+inline void drawCubicBezier(SDL_Surface* s, PointF p0, PointF c0, PointF c1, PointF p1,
+                            Color c, float width=1.f, bool aa=true) {
+    Path p; p.moveTo(p0.x,p0.y).cubicTo(c0.x,c0.y,c1.x,c1.y,p1.x,p1.y);
+    strokePath(s,p,c,width,aa);
+}
+
+} // namespace Draw
+
 // ═══════════════════════════════════════════════════════════════════════════
 //  SECTION 4 – Core Types: Rect, State, Event
 // ═══════════════════════════════════════════════════════════════════════════
@@ -331,6 +1209,24 @@ struct Rect {
     Rect offset(int dx,int dy) const { return Rect(x+dx,y+dy,w,h); }
 };
 
+struct Size {
+    int w,h;
+    Size(): w(0),h(0){}
+    Size(int w_,int h_): w(w_),h(h_){}
+};
+
+// Placement on a box's cross axis, or on both axes inside a grid cell
+enum class Align { Stretch, Start, Center, End };
+
+// Constraints a layout container (UIBox, UIGrid) reads from each child
+struct LayoutHint {
+    int   minW=0, minH=0, maxW=INT_MAX, maxH=INT_MAX;
+    int   prefW=-1, prefH=-1;     // -1: the rect size when first measured
+    float grow=0.f;               // share of spare space on a box's main axis
+    Align align=Align::Stretch;
+    int   col=0, row=0, colSpan=1, rowSpan=1;   // grid cell
+};
+
 enum class WidgetState { Normal, Hovered, Pressed, Disabled };
 
 enum class EventType {
@@ -343,10 +1239,41 @@ enum class EventType {
     ViewportFocusGained, ViewportFocusLost,
     Scroll
 };
+static_assert((int)EventType::Scroll<32,"UIComponent::cbMask holds one bit per EventType");
+
+// Non-owning view of a NUL-terminated string (a literal or an emitter's
+// std::string). Events carry it instead of a copy; it stays valid while the
+// handler runs, as long as the handler leaves the emitter's text alone.
+// Convert to std::string to keep it.
+struct StrRef {
+    StrRef() = default;
+    StrRef(const char* s) : p(s?s:""), n(s?std::strlen(s):0) {}
+    StrRef(const std::string& s) : p(s.c_str()), n(s.size()) {}
+
+    const char* c_str() const { return p; }
+    const char* data()  const { return p; }
+    size_t      size()  const { return n; }
+    bool        empty() const { return n==0; }
+    std::string str()   const { return std::string(p,n); }
+    operator std::string() const { return str(); }
+
+    bool operator==(StrRef o) const { return n==o.n&&std::memcmp(p,o.p,n)==0; }
+    bool operator!=(StrRef o) const { return !(*this==o); }
+    bool operator==(const char* s) const { return *this==StrRef(s); }
+    bool operator!=(const char* s) const { return !(*this==StrRef(s)); }
+    bool operator==(const std::string& s) const { return *this==StrRef(s); }
+    bool operator!=(const std::string& s) const { return !(*this==StrRef(s)); }
 
+private:
+    const char* p="";
+    size_t      n=0;
+};
+
+// Plain data: copying or dispatching an event never allocates
 struct UIEvent {
     EventType   type;
-    int         mx=0, my=0;      // mouse pos (screen)
+    int         mx=0, my=0;      // mouse pos in the receiver's parent space
+    int         sx=0, sy=0;      // mouse pos (screen)
     int         mbtn=0;          // SDL_BUTTON_*
     int         wheel=0;         // scroll delta
     SDL_Keycode key=0;
@@ -354,13 +1281,133 @@ struct UIEvent {
     const char* text=nullptr;    // UTF-8 text input
     float       fvalue=0.f;      // generic float payload
     int         ivalue=0;        // generic int payload
-    std::string svalue;          // generic string payload
+    StrRef      svalue;          // generic string payload (view, see StrRef)
+};
+static_assert(std::is_trivially_copyable<UIEvent>::value,"UIEvent must stay plain data");
+
+// ─── Widget ids ──────────────────────────────────────────────────────────────
+// FNV-1a over the id's bytes. The constexpr form lets "sld_p1"_wid be hashed
+// by the compiler; hashId() is the same function for run-time strings.
+constexpr uint32_t fnv1a(const char* s, size_t n, uint32_t h=2166136261u) {
+    return n ? fnv1a(s+1,n-1,(h^(uint8_t)*s)*16777619u) : h;
+}
+inline uint32_t hashId(StrRef s) {
+    uint32_t h=2166136261u;
+    for(size_t i=0;i<s.size();i++) h=(h^(uint8_t)s.data()[i])*16777619u;
+    return h;
+}
+
+struct WidgetId {
+    const char* name;
+    size_t      len;
+    uint32_t    hash;
+    constexpr WidgetId(const char* s, size_t n) : name(s), len(n), hash(fnv1a(s,n)) {}
+};
+constexpr WidgetId operator"" _wid(const char* s, size_t n) { return WidgetId(s,n); }
+
+// ─── Delegate ────────────────────────────────────────────────────────────────
+// Move-only std::function replacement for event handlers. Functors up to
+// three pointers in size (a [this] or [&a,&b] lambda) live inline, so
+// creating, storing and calling one never allocates; larger ones fall back
+// to a single heap block.
+template<class Sig> class Delegate;
+
+template<class R, class... A>
+class Delegate<R(A...)> {
+public:
+    Delegate() = default;
+    Delegate(std::nullptr_t) {}
+    template<class F, class D=typename std::decay<F>::type,
+             class=typename std::enable_if<!std::is_same<D,Delegate>::value>::type>
+    Delegate(F&& f) { assign<D>(std::forward<F>(f),Fits<D>()); }
+
+    Delegate(Delegate&& o) noexcept { take(o); }
+    Delegate& operator=(Delegate&& o) noexcept { if(this!=&o){ reset(); take(o); } return *this; }
+    Delegate(const Delegate&)=delete;
+    Delegate& operator=(const Delegate&)=delete;
+    ~Delegate() { reset(); }
+
+    explicit operator bool() const { return ops!=nullptr; }
+    R operator()(A... a) const { return ops->call(&buf,std::forward<A>(a)...); }
+
+    void reset() { if(ops) ops->drop(&buf); ops=nullptr; }
+
+private:
+    typedef typename std::aligned_storage<3*sizeof(void*),alignof(void*)>::type Buf;
+    template<class D> struct Fits : std::integral_constant<bool,
+        sizeof(D)<=sizeof(Buf) && alignof(Buf)%alignof(D)==0 &&
+        std::is_nothrow_move_constructible<D>::value> {};
+    struct Ops {
+        R    (*call)(const Buf*, A&&...);
+        void (*move)(Buf* dst, Buf* src);   // leaves src empty
+        void (*drop)(Buf*);
+    };
+
+    mutable Buf buf;
+    const Ops*  ops=nullptr;   // one static table per stored type
+
+    template<class D, class F> void assign(F&& f, std::true_type) {
+        static const Ops inl={
+            [](const Buf* b, A&&... a)->R { return (*(D*)b)(std::forward<A>(a)...); },
+            [](Buf* d, Buf* s){ new(d) D(std::move(*(D*)s)); ((D*)s)->~D(); },
+            [](Buf* b){ ((D*)b)->~D(); } };
+        new(&buf) D(std::forward<F>(f));
+        ops=&inl;
+    }
+    template<class D, class F> void assign(F&& f, std::false_type) {
+        static const Ops heap={
+            [](const Buf* b, A&&... a)->R { return (**(D* const*)b)(std::forward<A>(a)...); },
+            [](Buf* d, Buf* s){ *(D**)d=*(D**)s; },
+            [](Buf* b){ delete *(D**)b; } };
+        *(D**)&buf=new D(std::forward<F>(f));
+        ops=&heap;
+    }
+    void take(Delegate& o) {
+        if(!o.ops) return;
+        o.ops->move(&buf,&o.buf);
+        ops=o.ops; o.ops=nullptr;
+    }
 };
 
 // ═══════════════════════════════════════════════════════════════════════════
 //  SECTION 5 – UIComponent (Base)
 // ═══════════════════════════════════════════════════════════════════════════
 class UIContext;
+class UIComponent;
+
+// Tab order: (explicit tabIndex, or INT_MAX for 0) then order of addition
+typedef std::map<std::pair<int,uint32_t>, UIComponent*> FocusChain;
+
+// Uniform grid over one coordinate space: a parent's child space, or the
+// screen for top-level widgets. Each cell lists the widgets whose rect
+// overlaps it in paint order, so a point query only visits the few widgets
+// under the cursor. Small sibling lists are scanned directly instead.
+class HitGrid {
+public:
+    enum { CELL=64, MAX_CELLS=128, MIN_ITEMS=16 };
+    bool stale=true;        // rebuilt on the next query
+
+    void rebuild(const std::vector<std::unique_ptr<UIComponent>>& items);
+    void moved(UIComponent* c, const Rect& old);
+    // Candidates at (x,y), bottom to top; nullptr if outside every rect
+    const std::vector<UIComponent*>* at(int x, int y) const {
+        if(x<ox||y<oy) return nullptr;
+        int cx=(x-ox)/cw, cy=(y-oy)/ch;
+        if(cx>=cols||cy>=rows) return nullptr;
+        return &cells[cy*cols+cx];
+    }
+
+private:
+    int ox=0, oy=0, cw=CELL, ch=CELL, cols=0, rows=0;
+    std::vector<std::vector<UIComponent*>> cells;
+
+    template<class F> void forCells(const Rect& r, F f){
+        if(r.w<=0||r.h<=0) return;
+        int x0=std::max(0,(r.x-ox)/cw), x1=std::min(cols-1,(r.x+r.w-1-ox)/cw);
+        int y0=std::max(0,(r.y-oy)/ch), y1=std::min(rows-1,(r.y+r.h-1-oy)/ch);
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++) f(cells[y*cols+x]);
+    }
+};
 
 class UIComponent {
 public:
@@ -369,10 +1416,16 @@ public:
     std::string   tooltip;
 
     // Layout
-    Rect          rect;          // absolute screen rect
+    Rect          rect;          // in the parent's space (screen for top-level)
+    LayoutHint    hint;
+    bool          layoutDirty  = true;   // children need arranging
+    bool          measureDirty = true;   // cached measure() is stale
     int           layer = 0;
     bool          visible = true;
     bool          enabled = true;
+    // Tab order: >0 first, ascending; 0 in the order widgets were added;
+    // <0 never reached with Tab. Change it with setTabIndex().
+    int           tabIndex = 0;
 
     // State machine
     WidgetState   wstate = WidgetState::Normal;
@@ -384,11 +1437,24 @@ public:
 
     // Hierarchy
     UIComponent*  parent = nullptr;
+    UIContext*    context = nullptr;   // set while registered in a UIContext
+    std::atomic<UIContext*> postCtx{nullptr}; // same, but cleared under the context's postMtx
     std::vector<std::unique_ptr<UIComponent>> children;
-
-    // Event callbacks
-    using CB = std::function<void(UIComponent*, const UIEvent&)>;
-    std::unordered_map<int, std::vector<CB>> cbs;
+    int           idSlot = -1;       // interned id in context->idSlots
+    HitGrid       hitIndex;          // over children, in our child space
+    int           hitSeq = 0;        // paint-order slot in the parent's hitIndex
+    uint32_t      focusSeq = 0;      // order of addition, for the focus chain
+    bool          inFocusChain = false;
+    FocusChain::iterator focusPos;   // our entry while inFocusChain
+
+    // Event callbacks, in registration order; cbMask has bit (1<<type) set
+    // for every EventType with at least one handler
+    using CB = Delegate<void(UIComponent*, const UIEvent&)>;
+    struct Handler { EventType type; CB fn; };
+    std::vector<Handler> cbs;
+    std::vector<Handler> cbsAdded;   // registered while emitting; cbs must not move then
+    uint32_t      cbMask = 0;
+    int           emitDepth = 0;
 
     // Style overrides (optional)
     Color bgColor = Pal::FACE;
@@ -405,20 +1471,29 @@ public:
 
     // ── Callbacks ────────────────────────────────────────────────────────
     UIComponent* on(EventType t, CB cb) {
-        cbs[(int)t].push_back(std::move(cb));
+        // A running handler may live inside cbs, so growing it now would move it
+        (emitDepth?cbsAdded:cbs).push_back(Handler{t,std::move(cb)});
+        cbMask|=1u<<(int)t;
         return this;
     }
 
+    // Handlers registered while emitting run from the next emit on
     void emit(const UIEvent& e) {
-        auto it=cbs.find((int)e.type);
-        if(it!=cbs.end()) for(auto& cb: it->second) cb(this,e);
+        if(!(cbMask&(1u<<(int)e.type))) return;
+        emitDepth++;
+        for(size_t i=0,n=cbs.size();i<n;i++)
+            if(cbs[i].type==e.type) cbs[i].fn(this,e);
+        if(--emitDepth==0&&!cbsAdded.empty()){
+            for(auto& h: cbsAdded) cbs.push_back(std::move(h));
+            cbsAdded.clear();
+        }
     }
 
     // ── Dirty / Surface ──────────────────────────────────────────────────
     void markDirty() {
         dirty=true;
-        // propagate up so container knows to re-composite
-        if(parent) parent->dirty=true;
+        // propagate up so every container on the path re-composites
+        for(UIComponent* p=parent;p;p=p->parent) p->dirty=true;
     }
 
     void ensureSurf() {
@@ -432,12 +1507,79 @@ public:
 
     // ── State helpers ─────────────────────────────────────────────────────
     void setState(WidgetState s) { if(wstate!=s){wstate=s;markDirty();} }
-    void setEnabled(bool e) { enabled=e; setState(e?WidgetState::Normal:WidgetState::Disabled); }
-    void setVisible(bool v) { if(visible!=v){visible=v;markDirty();} }
-    void setRect(Rect r)    { if(r.x!=rect.x||r.y!=rect.y||r.w!=rect.w||r.h!=rect.h){rect=r;if(surf){SDL_FreeSurface(surf);surf=nullptr;}markDirty();} }
+    void setEnabled(bool e) { if(enabled!=e){enabled=e;syncFocus();} setState(e?WidgetState::Normal:WidgetState::Disabled); }
+    void setTabIndex(int i);
+    void setVisible(bool v) { if(visible!=v){visible=v;markDirty();if(parent)parent->invalidateLayout();syncFocus();} }
+    // A pure move keeps the surface; only a new size reallocates and redraws
+    void setRect(Rect r) {
+        if(r.w==rect.w&&r.h==rect.h){ moveTo(r.x,r.y); return; }
+        Rect old=rect;
+        rect=r;
+        reindex(old);
+        if(surf){SDL_FreeSurface(surf);surf=nullptr;}
+        markDirty();
+        // children may depend on our size
+        for(UIComponent* p=this;p&&!p->layoutDirty;p=p->parent) p->layoutDirty=true;
+    }
+    // Moves the widget within its parent, keeping every cached surface;
+    // only whatever composites it (parent or root) is redrawn.
+    void moveTo(int x, int y);
+    // Tells whoever indexes us for hit-testing that our rect changed
+    void reindex(const Rect& old);
+    // Re-evaluates our subtree's place in the context's focus chain
+    void syncFocus();
+    // Thread-safe markDirty for worker threads; false (a no-op) once unregistered
+    bool postInvalidate();
+    // Screen rectangle, resolved through the parent chain
+    Rect absRect() const {
+        Rect r=rect;
+        for(const UIComponent* p=parent;p;p=p->parent) p->mapFromChildSpace(r.x,r.y);
+        return r;
+    }
+
+    // ── Layout ───────────────────────────────────────────────────────────
+    // Preferred size within hint's min/max. Containers derive it from their
+    // children and cache it until invalidateLayout() reaches them.
+    virtual Size measure() {
+        if(hint.prefW<0) hint.prefW=rect.w;
+        if(hint.prefH<0) hint.prefH=rect.h;
+        return clampToHint(Size(hint.prefW,hint.prefH));
+    }
+
+    // Places the widget at r (parent space) and lays out whatever inside it
+    // is pending. Containers override it to position their children.
+    virtual void arrange(Rect r) {
+        setRect(r);
+        for(auto& ch: children) if(ch->layoutDirty) ch->arrange(ch->rect);
+        layoutDirty=false;
+    }
+
+    // Call after changing something measure() depends on (hint, text...):
+    // only containers on the path to the root re-measure and re-arrange.
+    void invalidateLayout() {
+        layoutDirty=measureDirty=true;
+        for(UIComponent* p=parent;p&&!(p->layoutDirty&&p->measureDirty);p=p->parent)
+            p->layoutDirty=p->measureDirty=true;
+    }
+
+    Size clampToHint(Size s) const {
+        s.w=std::max(hint.minW,std::min(s.w,hint.maxW));
+        s.h=std::max(hint.minH,std::min(s.h,hint.maxH));
+        return s;
+    }
+
+    // Frees the cached surfaces of this subtree; they are recreated and
+    // redrawn the next time it renders
+    virtual void releaseSurfaces() {
+        if(surf){ SDL_FreeSurface(surf); surf=nullptr; }
+        dirty=true;
+        for(auto& ch: children) ch->releaseSurfaces();
+    }
 
     // ── Children ─────────────────────────────────────────────────────────
     UIComponent* addChild(std::unique_ptr<UIComponent> c, UIContext& ctx);
+    // Unregisters and destroys a direct child
+    bool removeChild(UIComponent* c, UIContext& ctx);
 
     UIComponent* findById(const std::string& searchId) {
         if(id==searchId) return this;
@@ -454,13 +1596,21 @@ public:
 
     // ── Virtual interface ─────────────────────────────────────────────────
     virtual void onDraw() {}          // draw self onto this->surf (ONLY when dirty)
+    virtual bool focusable() const { return false; }   // takes part in Tab navigation
     virtual bool hitTest(int x,int y) const { return visible&&enabled&&rect.contains(x,y); }
 
+    // Maps a point from this widget's space (the one its rect is in) into
+    // the space its children's rects are expressed in: relative to its
+    // top-left corner, plus the scroll offset for scrolling containers.
+    // Returns false if the point is outside the area where children can be seen.
+    virtual bool mapToChildSpace(int& x, int& y) const { x-=rect.x; y-=rect.y; return true; }
+    virtual void mapFromChildSpace(int& x, int& y) const { x+=rect.x; y+=rect.y; }
+
     // Returns true if event was consumed
     virtual bool onEvent(const UIEvent& e, UIContext& ctx) { return false; }
 
     // ── Render (composite children) ───────────────────────────────────────
-    void render() {
+    virtual void render() {
         ensureSurf();
         if(dirty){
             onDraw();
@@ -468,7 +1618,7 @@ public:
             for(auto& ch: children){
                 if(!ch->visible) continue;
                 ch->render();
-                SDL_Rect dst={ch->rect.x-rect.x,ch->rect.y-rect.y,ch->rect.w,ch->rect.h};
+                SDL_Rect dst={ch->rect.x,ch->rect.y,ch->rect.w,ch->rect.h};
                 SDL_BlitSurface(ch->surf,nullptr,surf,&dst);
             }
             dirty=false;
@@ -476,38 +1626,499 @@ public:
     }
 };
 
-// ═══════════════════════════════════════════════════════════════════════════
-//  SECTION 6 – UIContext (registry, focus, event dispatch, main render loop)
-// ═══════════════════════════════════════════════════════════════════════════
-class UIContext {
-public:
-    // Root surface (full window)
-    SDL_Surface*  root = nullptr;
-    SDL_Texture*  tex  = nullptr;
-    SDL_Renderer* ren  = nullptr;
-    int           winW = 800, winH = 600;
+// ─── HitGrid ──────────────────────────────────────────────────────────────────
+inline void HitGrid::rebuild(const std::vector<std::unique_ptr<UIComponent>>& items) {
+    stale=false;
+    cells.clear(); cols=rows=0;
+    if(items.empty()) return;
+    int x0=INT_MAX, y0=INT_MAX, x1=INT_MIN, y1=INT_MIN;
+    for(auto& c: items){
+        const Rect& r=c->rect;
+        x0=std::min(x0,r.x); y0=std::min(y0,r.y);
+        x1=std::max(x1,r.x+r.w); y1=std::max(y1,r.y+r.h);
+    }
+    if(x1<=x0||y1<=y0) return;
+    ox=x0; oy=y0;
+    cw=std::max((int)CELL,(x1-x0+MAX_CELLS-1)/MAX_CELLS);
+    ch=std::max((int)CELL,(y1-y0+MAX_CELLS-1)/MAX_CELLS);
+    cols=(x1-x0+cw-1)/cw; rows=(y1-y0+ch-1)/ch;
+    cells.resize(cols*rows);
+    int seq=0;
+    for(auto& c: items){
+        UIComponent* p=c.get();
+        p->hitSeq=seq++;
+        forCells(p->rect,[p](std::vector<UIComponent*>& v){ v.push_back(p); });
+    }
+}
 
-    // All top-level components (owned)
-    std::vector<std::unique_ptr<UIComponent>> widgets;
-    // Flat registry id→ptr (includes children)
-    std::unordered_map<std::string, UIComponent*> registry;
+// Keeps the grid in step with one widget's new rect; anything leaving the
+// indexed bounds just rebuilds on the next query
+inline void HitGrid::moved(UIComponent* c, const Rect& old) {
+    if(stale) return;
+    const Rect& r=c->rect;
+    if(r.x<ox||r.y<oy||r.x+r.w>ox+cols*cw||r.y+r.h>oy+rows*ch){ stale=true; return; }
+    forCells(old,[c](std::vector<UIComponent*>& v){
+        auto it=std::find(v.begin(),v.end(),c);
+        if(it!=v.end()) v.erase(it);
+    });
+    forCells(r,[c](std::vector<UIComponent*>& v){
+        v.insert(std::upper_bound(v.begin(),v.end(),c,
+            [](const UIComponent* a, const UIComponent* b){ return a->hitSeq<b->hitSeq; }),c);
+    });
+}
 
-    // Focus
-    UIComponent*  focusedWidget   = nullptr;
-    UIComponent*  hoveredWidget   = nullptr;
-    UIComponent*  pressedWidget   = nullptr;
-    UIComponent*  activeViewport  = nullptr;  // for 3D editor
+// ─── TimerWheel ───────────────────────────────────────────────────────────────
+// Hierarchical timing wheel with 1 ms ticks: 256 one-tick slots, then three
+// levels of 64 slots (256 ms, 16 s, 17 min each) that cascade down as time
+// reaches them. Timers further than ~18 h out wait in an overflow list.
+// Adding and cancelling are O(1); advancing jumps straight between populated
+// slots, so an idle wheel costs nothing.
+typedef uint64_t TimerId;   // 0 = none
 
-    // State
-    bool          needsRedraw = true;
+class TimerWheel {
+public:
+    TimerWheel(){ std::fill(heads,heads+NSLOTS,-1); std::memset(bits,0,sizeof(bits)); }
+
+    // `now` is the caller's clock in ms; period 0 = one-shot
+    TimerId add(uint64_t now, uint32_t delay, uint32_t period, std::function<void()> cb,
+                const void* owner=nullptr){
+        int i;
+        if(!freeList.empty()){ i=freeList.back(); freeList.pop_back(); }
+        else { i=(int)nodes.size(); nodes.push_back(Node()); }
+        Node& n=nodes[i];
+        n.due=std::max(now+delay,cur+1);
+        n.period=period; n.owner=owner; n.cb=std::move(cb); n.dead=false;
+        link(i);
+        active++;
+        return ((uint64_t)n.gen<<32)|(uint32_t)(i+1);
+    }
 
-    // Menus
-    UIComponent*  openMenu = nullptr;
+    bool cancel(TimerId id){
+        uint32_t i=(uint32_t)id-1;
+        if(!id||i>=nodes.size()) return false;
+        Node& n=nodes[i];
+        if(n.gen!=(uint32_t)(id>>32)||n.slot==SLOT_FREE||n.dead) return false;
+        kill((int)i);
+        return true;
+    }
 
-    UIContext() = default;
+    void cancelOwner(const void* owner){
+        for(size_t i=0;i<nodes.size();i++)
+            if(nodes[i].owner==owner&&nodes[i].slot!=SLOT_FREE&&!nodes[i].dead) kill((int)i);
+    }
 
-    bool init(SDL_Renderer* r, int w, int h) {
+    // Fires everything due up to `now`. Callbacks may add or cancel timers.
+    // An interval that fell behind fires once and resumes on its phase.
+    void advance(uint64_t now){
+        if(busy) return;
+        busy=true;
+        target=now;
+        while(cur<now){
+            // Empty slots and boundaries with nothing to cascade are skipped
+            uint64_t next=nextDue();
+            if(next>now){ cur=now; break; }
+            cur=next;
+            if(!(cur&255)) cascade();
+            fire((int)(cur&255));
+        }
+        busy=false;
+    }
+
+    // Earliest time at which advance() has work to do; UINT64_MAX when empty.
+    // Timers on the upper levels report their cascade time, which is never late.
+    uint64_t nextDue() const {
+        if(!active) return UINT64_MAX;
+        int b=nextBit(0,(int)(cur&255)+1);
+        if(b>=0) return (cur&~(uint64_t)255)+b;
+        for(int lv=1;lv<=3;lv++){
+            int sh=2+6*lv;
+            int j=nextBit(lv,(int)((cur>>sh)&63)+1);
+            if(j>=0) return (cur&~((((uint64_t)1)<<(sh+6))-1))+((uint64_t)j<<sh);
+        }
+        return (cur|((((uint64_t)1)<<26)-1))+1;
+    }
+
+    size_t size() const { return active; }
+
+private:
+    enum { NSLOTS=256+3*64+1, FAR_SLOT=NSLOTS-1, SLOT_FREE=-1, SLOT_FIRING=-2 };
+    struct Node {
+        uint64_t due=0;
+        uint32_t period=0, gen=0;
+        int      prev=-1, next=-1, slot=SLOT_FREE;
+        bool     dead=false;
+        const void* owner=nullptr;
+        std::function<void()> cb;
+    };
+
+    std::deque<Node>  nodes;        // deque: references survive growth during callbacks
+    std::vector<int>  freeList, batch;
+    int               heads[NSLOTS];
+    uint64_t          bits[7];      // occupancy: 4 words for level 0, one per upper level
+    uint64_t          cur=0;        // last processed tick
+    uint64_t          target=0;     // `now` of the running advance()
+    size_t            active=0;
+    bool              busy=false;
+
+    static int slotBit(int s, int& word){
+        if(s<256){ word=s>>6; return s&63; }
+        word=4+(s-256)/64; return (s-256)&63;
+    }
+
+    // First occupied slot index >= from within a level, or -1
+    int nextBit(int lv, int from) const {
+        int words=lv?1:4, base=lv?3+lv:0;
+        for(int w=from>>6;w<words;w++){
+            uint64_t m=bits[base+w];
+            if(w==from>>6) m&=(from&63)?~((((uint64_t)1)<<(from&63))-1):~(uint64_t)0;
+            if(m) return w*64+ctz(m);
+        }
+        return -1;
+    }
+
+    static int ctz(uint64_t m){
+#if defined(__GNUC__)
+        return __builtin_ctzll(m);
+#else
+        int n=0; while(!(m&1)){ m>>=1; n++; } return n;
+#endif
+    }
+
+    void link(int i){
+        Node& n=nodes[i];
+        uint64_t d=std::max(n.due,cur);
+        int s;
+        if     ((d>>8) ==(cur>>8))  s=(int)(d&255);
+        else if((d>>14)==(cur>>14)) s=256+(int)((d>>8)&63);
+        else if((d>>20)==(cur>>20)) s=320+(int)((d>>14)&63);
+        else if((d>>26)==(cur>>26)) s=384+(int)((d>>20)&63);
+        else                        s=FAR_SLOT;
+        n.slot=s; n.prev=-1; n.next=heads[s];
+        if(heads[s]>=0) nodes[heads[s]].prev=i;
+        heads[s]=i;
+        if(s!=FAR_SLOT){ int w, b=slotBit(s,w); bits[w]|=((uint64_t)1)<<b; }
+    }
+
+    void unlink(int i){
+        Node& n=nodes[i];
+        if(n.prev>=0) nodes[n.prev].next=n.next; else heads[n.slot]=n.next;
+        if(n.next>=0) nodes[n.next].prev=n.prev;
+        if(heads[n.slot]<0&&n.slot!=FAR_SLOT){ int w, b=slotBit(n.slot,w); bits[w]&=~(((uint64_t)1)<<b); }
+        n.prev=n.next=-1;
+    }
+
+    // Detaches a whole slot into `out`
+    void take(int s, std::vector<int>& out){
+        for(int i=heads[s];i>=0;i=nodes[i].next){ out.push_back(i); nodes[i].slot=SLOT_FIRING; }
+        heads[s]=-1;
+        if(s!=FAR_SLOT){ int w, b=slotBit(s,w); bits[w]&=~(((uint64_t)1)<<b); }
+    }
+
+    void kill(int i){
+        Node& n=nodes[i];
+        if(n.slot==SLOT_FIRING){ n.dead=true; return; }   // released by fire()
+        unlink(i);
+        release(i);
+    }
+
+    void release(int i){
+        Node& n=nodes[i];
+        n.cb=nullptr; n.owner=nullptr; n.dead=false;
+        n.slot=SLOT_FREE; n.gen++;
+        freeList.push_back(i);
+        active--;
+    }
+
+    // Called at every 256-tick boundary; higher levels first so their timers
+    // can land in the lower slots that are cascaded right after.
+    void cascade(){
+        int i1=(int)((cur>>8)&63), i2=(int)((cur>>14)&63), i3=(int)((cur>>20)&63);
+        std::vector<int> moved;
+        if(!i1&&!i2&&!i3) take(FAR_SLOT,moved);
+        if(!i1&&!i2)      take(384+i3,moved);
+        if(!i1)           take(320+i2,moved);
+        take(256+i1,moved);
+        for(int i: moved){
+            if(nodes[i].dead) release(i); else link(i);
+        }
+    }
+
+    void fire(int s){
+        batch.clear();
+        take(s,batch);
+        for(int i: batch){
+            Node& n=nodes[i];
+            if(!n.dead&&n.cb) n.cb();
+            if(n.dead||!n.period){ release(i); continue; }
+            n.due+=n.period;
+            if(n.due<=target) n.due+=((target-n.due)/n.period+1)*n.period;
+            link(i);
+        }
+    }
+};
+
+// ─── Animator ────────────────────────────────────────────────────────────────
+// Tweens widget properties from the frame clock. Only the animated widgets
+// are invalidated, and position tweens move the cached surface instead of
+// redrawing it. An empty animator costs nothing per frame.
+enum class Ease { Linear, InQuad, OutQuad, InOutQuad, OutCubic, InOutCubic, OutBack };
+
+inline float applyEase(Ease e, float t) {
+    switch(e){
+    case Ease::Linear:     return t;
+    case Ease::InQuad:     return t*t;
+    case Ease::OutQuad:    return t*(2.f-t);
+    case Ease::InOutQuad:  return t<0.5f?2.f*t*t:-1.f+(4.f-2.f*t)*t;
+    case Ease::OutCubic:   { float u=t-1.f; return u*u*u+1.f; }
+    case Ease::InOutCubic: { float u=2.f*t-2.f; return t<0.5f?4.f*t*t*t:0.5f*u*u*u+1.f; }
+    case Ease::OutBack:    { const float c=1.70158f; float u=t-1.f; return 1.f+u*u*((c+1.f)*u+c); }
+    }
+    return t;
+}
+
+typedef uint64_t AnimId;    // 0 = none
+
+class Animator {
+public:
+    typedef std::function<void()> Done;
+
+    AnimId move(UIComponent* w, int x, int y, uint64_t now, uint32_t ms, Ease e, Done done){
+        Tween t=make(w,Kind::Move,&w->rect,now,ms,e,std::move(done));
+        t.from[0]=(float)w->rect.x; t.from[1]=(float)w->rect.y;
+        t.to[0]=(float)x;           t.to[1]=(float)y;
+        return push(t);
+    }
+    AnimId rect(UIComponent* w, Rect r, uint64_t now, uint32_t ms, Ease e, Done done){
+        Tween t=make(w,Kind::Rect,&w->rect,now,ms,e,std::move(done));
+        const Rect& a=w->rect;
+        t.from[0]=(float)a.x; t.from[1]=(float)a.y; t.from[2]=(float)a.w; t.from[3]=(float)a.h;
+        t.to[0]=(float)r.x;   t.to[1]=(float)r.y;   t.to[2]=(float)r.w;   t.to[3]=(float)r.h;
+        return push(t);
+    }
+    AnimId color(UIComponent* w, Color& c, Color to, uint64_t now, uint32_t ms, Ease e, Done done){
+        Tween t=make(w,Kind::Color,&c,now,ms,e,std::move(done));
+        t.from[0]=c.r;  t.from[1]=c.g;  t.from[2]=c.b;  t.from[3]=c.a;
+        t.to[0]=to.r;   t.to[1]=to.g;   t.to[2]=to.b;   t.to[3]=to.a;
+        return push(t);
+    }
+    AnimId value(UIComponent* w, float& v, float to, uint64_t now, uint32_t ms, Ease e, Done done){
+        Tween t=make(w,Kind::Float,&v,now,ms,e,std::move(done));
+        t.from[0]=v; t.to[0]=to;
+        return push(t);
+    }
+
+    // Applies the current value of every tween; finished ones are removed
+    // and their completion callbacks run last, so they may start new tweens.
+    void step(uint64_t now){
+        if(tweens.empty()) return;
+        std::vector<Done> finished;
+        for(size_t i=0;i<tweens.size();){
+            Tween& t=tweens[i];
+            float p=t.dur?std::min(1.f,(float)(now-std::min(now,t.start))/t.dur):1.f;
+            apply(t,applyEase(t.ease,p));
+            if(p<1.f){ i++; continue; }
+            if(t.done) finished.push_back(std::move(t.done));
+            tweens[i]=std::move(tweens.back());
+            tweens.pop_back();
+        }
+        for(auto& d: finished) d();
+    }
+
+    // Stops a tween where it is, or snaps it to its end value first
+    bool stop(AnimId id, bool finish){
+        for(size_t i=0;i<tweens.size();i++){
+            if(tweens[i].id!=id) continue;
+            Done d;
+            if(finish){ apply(tweens[i],1.f); d=std::move(tweens[i].done); }
+            tweens[i]=std::move(tweens.back());
+            tweens.pop_back();
+            if(d) d();
+            return true;
+        }
+        return false;
+    }
+
+    void cancelOwner(const UIComponent* w){
+        tweens.erase(std::remove_if(tweens.begin(),tweens.end(),
+            [w](const Tween& t){ return t.w==w; }),tweens.end());
+    }
+
+    bool running() const { return !tweens.empty(); }
+
+private:
+    enum class Kind { Move, Rect, Color, Float };
+    struct Tween {
+        AnimId       id;
+        UIComponent* w;
+        Kind         kind;
+        void*        target;        // &w->rect, a Color or a float owned by w
+        float        from[4], to[4];
+        uint64_t     start;
+        uint32_t     dur;
+        Ease         ease;
+        Done         done;
+    };
+
+    std::vector<Tween> tweens;
+    AnimId             nextId=1;
+
+    Tween make(UIComponent* w, Kind k, void* target, uint64_t now, uint32_t ms, Ease e, Done done){
+        Tween t;
+        t.id=0; t.w=w; t.kind=k; t.target=target;
+        std::fill(t.from,t.from+4,0.f); std::fill(t.to,t.to+4,0.f);
+        t.start=now; t.dur=ms; t.ease=e; t.done=std::move(done);
+        return t;
+    }
+
+    // A new tween on the same property replaces the old one, which then
+    // continues from wherever the old one had got to.
+    AnimId push(Tween& t){
+        tweens.erase(std::remove_if(tweens.begin(),tweens.end(),
+            [&](const Tween& o){ return o.target==t.target; }),tweens.end());
+        t.id=nextId++;
+        tweens.push_back(std::move(t));
+        return tweens.back().id;
+    }
+
+    static void apply(Tween& t, float e){
+        float v[4];
+        for(int k=0;k<4;k++) v[k]=t.from[k]+(t.to[k]-t.from[k])*e;
+        switch(t.kind){
+        case Kind::Move:
+            t.w->moveTo((int)std::lround(v[0]),(int)std::lround(v[1]));
+            break;
+        case Kind::Rect: {
+            Rect r((int)std::lround(v[0]),(int)std::lround(v[1]),
+                   std::max(0,(int)std::lround(v[2])),std::max(0,(int)std::lround(v[3])));
+            t.w->setRect(r);   // keeps the surface unless the size changed
+        } break;
+        case Kind::Color: {
+            Color& c=*(Color*)t.target;
+            auto ch=[](float f){ return (uint8_t)std::max(0.f,std::min(255.f,f+0.5f)); };
+            Color n{ch(v[0]),ch(v[1]),ch(v[2]),ch(v[3])};
+            if(!(n==c)){ c=n; t.w->markDirty(); }
+        } break;
+        case Kind::Float:
+            if(*(float*)t.target!=v[0]){ *(float*)t.target=v[0]; t.w->markDirty(); }
+            break;
+        }
+    }
+};
+
+// ─── InputCoalescer ──────────────────────────────────────────────────────────
+// Collects one frame's SDL events and folds each run of consecutive
+// SDL_MOUSEMOTION (latest position, summed xrel/yrel) or SDL_MOUSEWHEEL
+// (summed deltas) into a single event, so per-motion handler work happens
+// at most once per run. Buttons, keys and everything else keep their order,
+// and a motion on either side of a click is never merged across it.
+class InputCoalescer {
+public:
+    std::vector<SDL_Event> events;
+
+    void clear() { events.clear(); }
+
+    void push(const SDL_Event& ev) {
+        if(!events.empty()){
+            SDL_Event& last=events.back();
+            if(ev.type==SDL_MOUSEMOTION&&last.type==SDL_MOUSEMOTION&&
+               ev.motion.which==last.motion.which&&ev.motion.windowID==last.motion.windowID&&
+               ev.motion.state==last.motion.state){
+                Sint32 xr=last.motion.xrel+ev.motion.xrel, yr=last.motion.yrel+ev.motion.yrel;
+                last=ev;
+                last.motion.xrel=xr; last.motion.yrel=yr;
+                return;
+            }
+            if(ev.type==SDL_MOUSEWHEEL&&last.type==SDL_MOUSEWHEEL&&
+               ev.wheel.which==last.wheel.which&&ev.wheel.windowID==last.wheel.windowID&&
+               ev.wheel.direction==last.wheel.direction){
+                last.wheel.x+=ev.wheel.x; last.wheel.y+=ev.wheel.y;
+#if defined(SDL_VERSION_ATLEAST)
+#if SDL_VERSION_ATLEAST(2,0,18)
+                last.wheel.preciseX+=ev.wheel.preciseX; last.wheel.preciseY+=ev.wheel.preciseY;
+#endif
+#endif
+                last.wheel.timestamp=ev.wheel.timestamp;
+                return;
+            }
+        }
+        events.push_back(ev);
+    }
+
+    // Drains SDL's queue into `events` (after clearing it)
+    void poll() {
+        events.clear();
+        SDL_Event ev;
+        while(SDL_PollEvent(&ev)) push(ev);
+    }
+};
+
+// ─── WidgetRef ───────────────────────────────────────────────────────────────
+// Typed handle to whatever widget currently holds an id (see UIContext::ref).
+// Resolving is a table index plus, only when that widget changed, one
+// dynamic_cast; a missing widget or one of another type gives nullptr.
+template<class T>
+class WidgetRef {
+public:
+    WidgetRef() = default;
+    WidgetRef(UIContext& c, int slot_) : ctx(&c), slot(slot_) {}
+
+    T* get() const;
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return get()!=nullptr; }
+
+private:
+    UIContext* ctx=nullptr;
+    int        slot=-1;
+    mutable uint32_t gen=0;       // slot generation `typed` was resolved for
+    mutable T*       typed=nullptr;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+//  SECTION 6 – UIContext (registry, focus, event dispatch, main render loop)
+// ═══════════════════════════════════════════════════════════════════════════
+class UIContext {
+public:
+    // Root surface (full window)
+    SDL_Surface*  root = nullptr;
+    SDL_Texture*  tex  = nullptr;
+    SDL_Renderer* ren  = nullptr;
+    int           winW = 800, winH = 600;
+
+    // All top-level components (owned)
+    std::vector<std::unique_ptr<UIComponent>> widgets;
+    HitGrid hitIndex;                 // over widgets, in screen space
+    // Interned ids (includes children): one slot per distinct id ever
+    // registered or referenced. Slots outlive their widgets, so WidgetRefs
+    // keep working when a widget with the same id comes back.
+    struct IdSlot {
+        std::string  name;
+        UIComponent* w = nullptr;
+        uint32_t     gen = 1;     // bumped whenever w changes
+        int          next = -1;   // next slot with the same hash
+    };
+    std::vector<IdSlot> idSlots;
+    std::unordered_map<uint32_t,int> idHeads;   // hash → first slot
+
+    // Focus
+    UIComponent*  focusedWidget   = nullptr;
+    UIComponent*  hoveredWidget   = nullptr;
+    UIComponent*  pressedWidget   = nullptr;
+    UIComponent*  activeViewport  = nullptr;  // for 3D editor
+
+    // State
+    bool          needsRedraw = true;
+
+    // Menus
+    UIComponent*  openMenu = nullptr;
+
+    // Hover time before a widget's tooltip appears
+    uint32_t      tooltipDelay = 500;
+
+    UIContext() = default;
+
+    bool init(SDL_Renderer* r, int w, int h) {
         ren=r; winW=w; winH=h;
+        wakeEvent=SDL_RegisterEvents(1);
         root=SDL_CreateRGBSurface(0,w,h,32,0x00FF0000,0x0000FF00,0x000000FF,0xFF000000);
         tex =SDL_CreateTexture(r,SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_STREAMING,w,h);
         return root&&tex;
@@ -519,10 +2130,14 @@ public:
         if(tex)  SDL_DestroyTexture(tex);
         root=SDL_CreateRGBSurface(0,w,h,32,0x00FF0000,0x0000FF00,0x000000FF,0xFF000000);
         tex =SDL_CreateTexture(ren,SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_STREAMING,w,h);
-        for(auto& w2: widgets) w2->markDirty();
+        // Widget surfaces are still valid; the new root just re-composites them
         needsRedraw=true;
     }
 
+    // Widgets may own worker threads that post invalidations; release them
+    // while the post queue is still alive.
+    ~UIContext(){ widgets.clear(); }
+
     void destroy() {
         if(root) SDL_FreeSurface(root);
         if(tex)  SDL_DestroyTexture(tex);
@@ -532,6 +2147,7 @@ public:
     UIComponent* add(std::unique_ptr<UIComponent> c) {
         auto* ptr=c.get();
         registerWidget(ptr);
+        syncFocus(ptr,true);
         // sort by layer
         widgets.push_back(std::move(c));
         sortWidgets();
@@ -546,6 +2162,7 @@ public:
                 if(focusedWidget==it->get()) focusedWidget=nullptr;
                 if(hoveredWidget==it->get()) hoveredWidget=nullptr;
                 widgets.erase(it);
+                hitIndex.stale=true;
                 needsRedraw=true;
                 return true;
             }
@@ -553,9 +2170,49 @@ public:
         return false;
     }
 
-    UIComponent* findById(const std::string& id) {
-        auto it=registry.find(id);
-        return it!=registry.end()?it->second:nullptr;
+    // Drops a subtree that is about to be destroyed from the registry and
+    // from every pointer the context keeps into it
+    void forget(UIComponent* c) {
+        unregisterWidget(c);
+        UIComponent** refs[]={&focusedWidget,&hoveredWidget,&pressedWidget,&activeViewport,&openMenu};
+        for(auto* r: refs)
+            for(UIComponent* w=*r;w;w=w->parent) if(w==c){ *r=nullptr; break; }
+        needsRedraw=true;
+    }
+
+    UIComponent* findById(StrRef id) {
+        int i=lookupId(id,hashId(id));
+        return i>=0?idSlots[i].w:nullptr;
+    }
+    UIComponent* findById(WidgetId id) {
+        int i=lookupId(StrRef(id.name),id.hash);
+        return i>=0?idSlots[i].w:nullptr;
+    }
+
+    // Handle that resolves by slot index; the widget may be added later
+    template<class T> WidgetRef<T> ref(StrRef id) { return WidgetRef<T>(*this,internId(id,hashId(id))); }
+    template<class T> WidgetRef<T> ref(WidgetId id) { return WidgetRef<T>(*this,internId(StrRef(id.name),id.hash)); }
+
+    int lookupId(StrRef name, uint32_t hash) const {
+        auto it=idHeads.find(hash);
+        if(it==idHeads.end()) return -1;
+        for(int i=it->second;i>=0;i=idSlots[i].next)
+            if(name==idSlots[i].name) return i;
+        return -1;
+    }
+    int internId(StrRef name, uint32_t hash) {
+        int i=lookupId(name,hash);
+        if(i>=0) return i;
+        IdSlot sl; sl.name=name;
+        auto it=idHeads.find(hash);
+        if(it!=idHeads.end()) sl.next=it->second;
+        idSlots.push_back(std::move(sl));
+        return idHeads[hash]=(int)idSlots.size()-1;
+    }
+    void bindId(UIComponent* c) {
+        if(c->id.empty()) return;
+        IdSlot& sl=idSlots[c->idSlot=internId(c->id,hashId(c->id))];
+        if(sl.w!=c){ sl.w=c; sl.gen++; }
     }
 
     // ── Focus ────────────────────────────────────────────────────────────
@@ -582,11 +2239,40 @@ public:
     UIComponent* getActiveViewport() { return activeViewport; }
     bool hasFocus(const std::string& id) { return focusedWidget&&focusedWidget->id==id; }
 
+    // Visible, enabled focusable widgets in Tab order; kept current by
+    // add/remove, setVisible, setEnabled and setTabIndex
+    FocusChain focusChain;
+    uint32_t   focusSeq = 0;
+
+    void syncFocus(UIComponent* c, bool shown) {
+        if(!c->focusSeq) c->focusSeq=++focusSeq;
+        shown=shown&&c->visible&&c->enabled;
+        bool want=shown&&c->tabIndex>=0&&c->focusable();
+        if(want!=c->inFocusChain){
+            if(want) c->focusPos=focusChain.insert(std::make_pair(
+                std::make_pair(c->tabIndex>0?c->tabIndex:INT_MAX,c->focusSeq),c)).first;
+            else focusChain.erase(c->focusPos);
+            c->inFocusChain=want;
+        }
+        for(auto& ch: c->children) syncFocus(ch.get(),shown);
+    }
+
     // ── Event Processing ─────────────────────────────────────────────────
     void processEvent(const SDL_Event& sdl_ev);
 
+    // Converts a screen point into the space c->rect is expressed in
+    static void toLocal(const UIComponent* c, int& x, int& y) {
+        if(!c||!c->parent) return;
+        toLocal(c->parent,x,y);
+        c->parent->mapToChildSpace(x,y);
+    }
+
     // ── Render ───────────────────────────────────────────────────────────
     void render() {
+        runTimers();
+        anim.step(nowMs());
+        if(hasPosted.load(std::memory_order_acquire)) drainPosted();
+        for(auto& w: widgets) if(w->layoutDirty) w->arrange(w->rect);
         if(!needsRedraw) {
             // check if any widget is dirty
             bool any=false;
@@ -602,6 +2288,7 @@ public:
             SDL_Rect dst={w->rect.x,w->rect.y,w->rect.w,w->rect.h};
             SDL_BlitSurface(w->surf,nullptr,root,&dst);
         }
+        if(tipShown&&tipFor) drawTooltip();
         // Upload to GPU texture
         SDL_UpdateTexture(tex,nullptr,root->pixels,root->pitch);
         SDL_RenderClear(ren);
@@ -612,56 +2299,253 @@ public:
 
     void invalidate() { needsRedraw=true; }
 
+    // Thread-safe: may be called from worker threads. The widget is marked
+    // dirty at the start of the next render() on the UI thread. Posts for a
+    // widget that is no longer registered here are dropped (returns false).
+    bool postInvalidate(UIComponent* c) {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lk(postMtx);
+            if(c->postCtx.load(std::memory_order_relaxed)!=this) return false;
+            if(std::find(posted.begin(),posted.end(),c)==posted.end()) posted.push_back(c);
+            wake=!hasPosted.exchange(true,std::memory_order_release);
+        }
+        // Wakes a loop blocked in SDL_WaitEvent; processEvent ignores it
+        if(wake&&wakeEvent!=(Uint32)-1){
+            SDL_Event ev; std::memset(&ev,0,sizeof(ev));
+            ev.type=wakeEvent;
+            SDL_PushEvent(&ev);
+        }
+        return true;
+    }
+
+    // ── Timers ───────────────────────────────────────────────────────────
+    // UI thread only. Callbacks run at the start of render() (or from
+    // runTimers()); timers given an owner die with that widget's registration.
+    TimerId setTimeout(uint32_t ms, std::function<void()> cb, UIComponent* owner=nullptr) {
+        return timers.add(nowMs(),ms,0,std::move(cb),owner);
+    }
+    TimerId setInterval(uint32_t ms, std::function<void()> cb, UIComponent* owner=nullptr) {
+        ms=std::max(1u,ms);
+        return timers.add(nowMs(),ms,ms,std::move(cb),owner);
+    }
+    bool clearTimer(TimerId id) { return timers.cancel(id); }
+    void runTimers() { timers.advance(nowMs()); }
+
+    // ── Animation ────────────────────────────────────────────────────────
+    // Tweens advance at the start of render(). `done` runs once the end
+    // value is applied; starting a tween on a property already animating
+    // takes over from its current value.
+    AnimId animateMove(UIComponent* w, int x, int y, uint32_t ms, Ease e=Ease::OutQuad,
+                       std::function<void()> done=nullptr) {
+        return anim.move(w,x,y,nowMs(),ms,e,std::move(done));
+    }
+    AnimId animateRect(UIComponent* w, Rect r, uint32_t ms, Ease e=Ease::OutQuad,
+                       std::function<void()> done=nullptr) {
+        return anim.rect(w,r,nowMs(),ms,e,std::move(done));
+    }
+    // `c` / `v` must live as long as `w` (typically a member of it)
+    AnimId animateColor(UIComponent* w, Color& c, Color to, uint32_t ms, Ease e=Ease::Linear,
+                        std::function<void()> done=nullptr) {
+        return anim.color(w,c,to,nowMs(),ms,e,std::move(done));
+    }
+    AnimId animateFloat(UIComponent* w, float& v, float to, uint32_t ms, Ease e=Ease::Linear,
+                        std::function<void()> done=nullptr) {
+        return anim.value(w,v,to,nowMs(),ms,e,std::move(done));
+    }
+    bool stopAnimation(AnimId id, bool finish=false) { return anim.stop(id,finish); }
+    void stopAnimations(UIComponent* w) { anim.cancelOwner(w); }
+    // True while any tween is running; the run loop keeps producing frames
+    bool isAnimating() const { return anim.running(); }
+
+    // Milliseconds until the next timer needs servicing, -1 if none pending
+    int msUntilNextTimer() {
+        uint64_t due=timers.nextDue();
+        if(due==UINT64_MAX) return -1;
+        uint64_t now=nowMs();
+        return due<=now?0:(int)std::min<uint64_t>(due-now,INT_MAX);
+    }
+
     static bool layerLess(const std::unique_ptr<UIComponent>& a,
                           const std::unique_ptr<UIComponent>& b){ return a->layer<b->layer; }
 
 private:
+    std::mutex                postMtx;
+    std::vector<UIComponent*> posted, postedSwap;
+    std::atomic<bool>         hasPosted{false};
+    Uint32                    wakeEvent=(Uint32)-1;
+
+    TimerWheel   timers;
+    Animator     anim;
+    uint64_t     clockMs=0;
+    Uint32       lastTicks=0;
+
+    // Tooltip
+    UIComponent* tipFor=nullptr;
+    TimerId      tipTimer=0;
+    bool         tipShown=false;
+    int          tipX=0, tipY=0;
+
+    // 64-bit millisecond clock; SDL_GetTicks wraps after 49 days
+    uint64_t nowMs() {
+        Uint32 t=SDL_GetTicks();
+        clockMs+=(Uint32)(t-lastTicks);
+        lastTicks=t;
+        return clockMs;
+    }
+
+    void hideTooltip() {
+        if(tipTimer){ timers.cancel(tipTimer); tipTimer=0; }
+        if(tipShown){ tipShown=false; needsRedraw=true; }
+        tipFor=nullptr;
+    }
+
+    void drawTooltip() {
+        const std::string& t=tipFor->tooltip;
+        int w=Draw::textWidth(t)+8, h=Draw::textHeight()+4;
+        int x=std::max(0,std::min(tipX,winW-w)), y=tipY+20;
+        if(y+h>winH) y=std::max(0,tipY-h-4);
+        Draw::fillRect(root,x,y,w,h,Pal::TIP_BG);
+        Draw::drawRect(root,x,y,w,h,Pal::TIP_BORDER);
+        Draw::drawText(root,x+4,y+2,t,Pal::TEXT);
+    }
+
+    void drainPosted(){
+        {
+            std::lock_guard<std::mutex> lk(postMtx);
+            posted.swap(postedSwap);
+            hasPosted.store(false,std::memory_order_relaxed);
+        }
+        for(auto* c: postedSwap) c->markDirty();
+        postedSwap.clear();
+    }
+
     void registerWidget(UIComponent* c) {
-        if(!c->id.empty()) registry[c->id]=c;
+        bindId(c);
+        c->context=this;
+        c->postCtx.store(this,std::memory_order_release);
         for(auto& ch: c->children) registerWidget(ch.get());
     }
     void unregisterWidget(UIComponent* c) {
-        if(!c->id.empty()) registry.erase(c->id);
+        if(c->idSlot>=0&&idSlots[c->idSlot].w==c){ idSlots[c->idSlot].w=nullptr; idSlots[c->idSlot].gen++; }
+        c->context=nullptr;
+        if(c->inFocusChain){ focusChain.erase(c->focusPos); c->inFocusChain=false; }
+        timers.cancelOwner(c);
+        anim.cancelOwner(c);
+        if(tipFor==c) hideTooltip();
+        {
+            std::lock_guard<std::mutex> lk(postMtx);
+            c->postCtx.store(nullptr,std::memory_order_relaxed);
+            posted.erase(std::remove(posted.begin(),posted.end(),c),posted.end());
+        }
         for(auto& ch: c->children) unregisterWidget(ch.get());
     }
     void sortWidgets(){
         std::stable_sort(widgets.begin(),widgets.end(),layerLess);
+        hitIndex.stale=true;
     }
-    // Find deepest hit widget (children first)
+    // Find deepest hit widget (children first). Children are clipped to
+    // their parent's surface when painted, so the search never leaves it.
     UIComponent* hitTestAll(UIComponent* root_c, int x, int y){
-        // children reverse order (top layer first)
-        for(int i=(int)root_c->children.size()-1;i>=0;i--){
-            auto* ch=root_c->children[i].get();
-            if(!ch->visible||!ch->enabled) continue;
-            auto* r=hitTestAll(ch,x,y);
-            if(r) return r;
-        }
+        if(!root_c->rect.contains(x,y)) return nullptr;
+        int cx=x, cy=y;
+        if(root_c->mapToChildSpace(cx,cy))
+            if(auto* r=hitTestList(root_c->children,root_c->hitIndex,cx,cy)) return r;
         if(root_c->hitTest(x,y)) return root_c;
         return nullptr;
     }
-    UIComponent* hitTest(int x,int y){
-        for(int i=(int)widgets.size()-1;i>=0;i--){
-            auto& w=widgets[i];
-            if(!w->visible||!w->enabled) continue;
-            auto* r=hitTestAll(w.get(),x,y);
-            if(r) return r;
+    // Top layer first; long lists go through their grid
+    UIComponent* hitTestList(const std::vector<std::unique_ptr<UIComponent>>& list, HitGrid& grid, int x, int y){
+        if(list.size()<HitGrid::MIN_ITEMS){
+            for(int i=(int)list.size()-1;i>=0;i--){
+                auto* ch=list[i].get();
+                if(!ch->visible||!ch->enabled) continue;
+                if(auto* r=hitTestAll(ch,x,y)) return r;
+            }
+            return nullptr;
+        }
+        if(grid.stale) grid.rebuild(list);
+        const std::vector<UIComponent*>* cell=grid.at(x,y);
+        if(!cell) return nullptr;
+        for(auto it=cell->rbegin();it!=cell->rend();++it){
+            if(!(*it)->visible||!(*it)->enabled) continue;
+            if(auto* r=hitTestAll(*it,x,y)) return r;
         }
         return nullptr;
     }
+    UIComponent* hitTest(int x,int y){ return hitTestList(widgets,hitIndex,x,y); }
 };
 
 // addChild needs UIContext defined, so implement here
+inline void UIComponent::reindex(const Rect& old) {
+    if(parent) parent->hitIndex.moved(this,old);
+    else if(context) context->hitIndex.moved(this,old);
+}
+
+template<class T> T* WidgetRef<T>::get() const {
+    if(slot<0) return nullptr;
+    const UIContext::IdSlot& sl=ctx->idSlots[slot];
+    if(sl.gen!=gen){ gen=sl.gen; typed=dynamic_cast<T*>(sl.w); }
+    return typed;
+}
+
+inline void UIComponent::syncFocus() {
+    if(!context) return;
+    bool shown=true;
+    for(UIComponent* p=parent;p&&shown;p=p->parent) shown=p->visible&&p->enabled;
+    context->syncFocus(this,shown);
+}
+
+inline bool UIComponent::postInvalidate() {
+    UIContext* c=postCtx.load(std::memory_order_acquire);
+    return c&&c->postInvalidate(this);
+}
+
+inline void UIComponent::setTabIndex(int i) {
+    if(i==tabIndex) return;
+    if(inFocusChain&&context){ context->focusChain.erase(focusPos); inFocusChain=false; }
+    tabIndex=i;
+    syncFocus();
+}
+
+inline void UIComponent::moveTo(int x, int y) {
+    if(x==rect.x&&y==rect.y) return;
+    Rect old=rect;
+    rect.x=x; rect.y=y;
+    reindex(old);
+    if(parent) parent->markDirty();
+    else if(context) context->needsRedraw=true;
+}
+
+inline bool UIComponent::removeChild(UIComponent* c, UIContext& ctx) {
+    for(auto it=children.begin();it!=children.end();++it){
+        if(it->get()!=c) continue;
+        ctx.forget(c);
+        children.erase(it);
+        hitIndex.stale=true;
+        invalidateLayout();
+        markDirty();
+        return true;
+    }
+    return false;
+}
+
 inline UIComponent* UIComponent::addChild(std::unique_ptr<UIComponent> c, UIContext& ctx) {
     c->parent=this;
     auto* ptr=c.get();
     // register in context
     std::function<void(UIComponent*)> reg=[&](UIComponent* cc){
-        if(!cc->id.empty()) ctx.registry[cc->id]=cc;
+        ctx.bindId(cc);
+        cc->context=&ctx;
+        cc->postCtx.store(&ctx,std::memory_order_release);
         for(auto& ch: cc->children) reg(ch.get());
     };
     reg(ptr);
     children.push_back(std::move(c));
+    ptr->syncFocus();
     std::stable_sort(children.begin(),children.end(),UIContext::layerLess);
+    hitIndex.stale=true;
+    ptr->invalidateLayout();
     markDirty();
     return ptr;
 }
@@ -688,10 +2572,15 @@ public:
 };
 
 // ─── UILabel ────────────────────────────────────────────────────────────────
+// Honours '\n', optional word wrap and ellipsis. Line breaks are cached and
+// only recomputed from the first line a text change can affect, so appending
+// to a long label (or rewriting its tail) does not re-measure the head.
 class UILabel : public UIComponent {
 public:
     std::string text;
-    int align=0; // 0=left, 1=center, 2=right
+    int  align=0;        // 0=left, 1=center, 2=right
+    bool wrap=false;     // break long lines at spaces
+    bool ellipsis=false; // end clipped lines with "..."
 
     UILabel(const std::string& id_, Rect r, const std::string& t, bool dark=false)
         : UIComponent(id_,r), text(t) {
@@ -700,18 +2589,141 @@ public:
         bgColor = dark ? Pal::DARK_PANEL : Pal::FACE;
     }
 
-    void setText(const std::string& t){ text=t; markDirty(); }
+    void setText(const std::string& t){
+        if(t==text) return;
+        size_t p=0, n=std::min(t.size(),text.size());
+        while(p<n&&t[p]==text[p]) p++;
+        text=t; relayoutFrom(p); markDirty();
+    }
+
+    void appendText(const std::string& t){
+        if(t.empty()) return;
+        size_t p=text.size();
+        text+=t; relayoutFrom(p); markDirty();
+    }
+
+    void setWrap(bool w){ if(wrap!=w){ wrap=w; markDirty(); } }
 
     const std::string& getText() const { return text; }
 
+    int lineCount() { layout(); return (int)lines.size(); }
+
     void onDraw() override {
         Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor);
         Color fg = enabled ? fgColor : Pal::DISABLED_TXT;
-        if(align==1) Draw::drawTextCentered(surf,0,0,rect.w,rect.h,text,fg);
-        else if(align==0) Draw::drawTextLeft(surf,0,0,rect.h,text,fg);
-        else {
-            int tw=(int)text.size()*8;
-            Draw::drawText(surf,rect.w-tw-4,(rect.h-8)/2,text,fg);
+        layout();
+        int lh=Draw::textHeight();
+        int n=(int)lines.size();
+        // A single line keeps the old vertically centred look
+        int y=n==1?(rect.h-lh)/2:PAD_Y;
+        int maxLines=n==1?1:std::max(1,(rect.h-PAD_Y+lh-1)/lh);
+        int shown=std::min(n,maxLines);
+        for(int i=0;i<shown;i++,y+=lh){
+            const Line& L=lines[i];
+            bool cut=ellipsis&&(L.width>avail()||(i==shown-1&&shown<n));
+            if(cut){
+                clipped.assign(text,L.start,L.len);
+                fitEllipsis(clipped);
+                drawLine(clipped,Draw::textWidth(clipped),y,fg);
+            } else {
+                clipped.assign(text,L.start,L.len);
+                drawLine(clipped,L.width,y,fg);
+            }
+        }
+    }
+
+private:
+    struct Line { size_t start, len; int width; };
+    static const int PAD_X=4, PAD_Y=2;
+
+    std::vector<Line> lines;
+    int         layoutW=-1;   // width the cache was built for (-1 = stale)
+    const Font* layoutFont=nullptr;
+    bool        layoutWrap=false;
+    std::string clipped;      // scratch for the line being drawn
+
+    int avail() const { return std::max(1,rect.w-PAD_X*2); }
+
+    void drawLine(const std::string& s, int w, int y, Color fg){
+        int x=align==1?(rect.w-w)/2:align==2?rect.w-w-PAD_X:PAD_X;
+        Draw::drawText(surf,x,y,s,fg);
+    }
+
+    void fitEllipsis(std::string& s) const {
+        const Font& f=Font::active();
+        int budget=avail()-f.measure("...",3);
+        size_t k=s.size();
+        while(k>0&&f.measure(s.data(),k)>budget) k=Utf8::prev(s,k);
+        s.resize(k); s+="...";
+    }
+
+    void layout(){
+        if(layoutW==avail()&&layoutFont==&Font::active()&&layoutWrap==wrap) return;
+        lines.clear();
+        layoutW=avail(); layoutFont=&Font::active(); layoutWrap=wrap;
+        layoutFrom(0);
+    }
+
+    // Keep lines that end before the change; the line holding p and the one
+    // before it (whose break depends on the next word) are laid out again.
+    void relayoutFrom(size_t p){
+        if(layoutW!=avail()||layoutFont!=&Font::active()||layoutWrap!=wrap||lines.empty()){ layoutW=-1; return; }
+        size_t k=0, lo=0, hi=lines.size();
+        while(lo<hi){ size_t m=(lo+hi)/2; if(lines[m].start<=p){ k=m; lo=m+1; } else hi=m; }
+        if(k>0) k--;
+        size_t from=lines[k].start;
+        lines.resize(k);
+        layoutFrom(from);
+    }
+
+    void layoutFrom(size_t pos){
+        const Font& f=Font::active();
+        int maxW=avail();
+        const char* s=text.data();
+        size_t n=text.size();
+        while(true){
+            size_t eol=text.find('\n',pos);
+            if(eol==std::string::npos) eol=n;
+            if(!wrap){
+                lines.push_back(Line{pos,eol-pos,f.measure(s+pos,eol-pos)});
+            } else {
+                size_t ls=pos;
+                do {
+                    // Grow the line word by word while it fits
+                    size_t end=ls, i=ls;
+                    int w=0;
+                    while(i<eol){
+                        size_t ws=i;
+                        while(i<eol&&s[i]==' ') i++;
+                        while(i<eol&&s[i]!=' ') i++;
+                        int nw=f.measure(s+ls,i-ls);
+                        if(nw>maxW&&end>ls) break;
+                        end=i; w=nw;
+                        if(nw>maxW){
+                            // A single word wider than the label: split it
+                            end=ws==ls?ls:ws;
+                            size_t j=end;
+                            while(j<i){
+                                size_t nj=Utf8::next(text,j);
+                                if(j>end&&f.measure(s+ls,nj-ls)>maxW) break;
+                                j=nj;
+                            }
+                            end=std::max(j,Utf8::next(text,ls));
+                            w=f.measure(s+ls,end-ls);
+                            break;
+                        }
+                    }
+                    // Trailing spaces don't count towards alignment
+                    size_t te=end;
+                    while(te>ls&&s[te-1]==' ') te--;
+                    if(te!=end) w=f.measure(s+ls,te-ls);
+                    lines.push_back(Line{ls,te-ls,w});
+                    ls=end;
+                    while(ls<eol&&s[ls]==' ') ls++;
+                } while(ls<eol);
+            }
+            if(eol>=n) break;
+            pos=eol+1;
         }
     }
 };
@@ -721,6 +2733,7 @@ class UIButton : public UIComponent {
 public:
     std::string text;
     bool flat=false; // flat toolbar-style
+    float hot=0.f;   // hover highlight 0..1, faded by the context animator
 
     UIButton(const std::string& id_, Rect r, const std::string& t)
         : UIComponent(id_,r), text(t) {}
@@ -737,19 +2750,33 @@ public:
         } else {
             Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::FACE);
             Draw::drawBevel(surf,0,0,rect.w,rect.h,!pressed);
+            if(hot>0.f&&!pressed&&!dis){
+                Color h=Pal::FACE.mix(Pal::HOT,std::min(1.f,hot));
+                Draw::drawRect(surf,2,2,rect.w-4,rect.h-4,h);
+                Draw::drawRect(surf,3,3,rect.w-6,rect.h-6,h);
+            }
         }
         int ox=pressed?1:0, oy=pressed?1:0;
         Color fg = dis ? Pal::DISABLED_TXT : Pal::TEXT;
-        int tw=(int)text.size()*8;
-        Draw::drawText(surf,ox+(rect.w-tw)/2,oy+(rect.h-8)/2,text,fg);
+        int tw=Draw::textWidth(text);
+        Draw::drawText(surf,ox+(rect.w-tw)/2,oy+(rect.h-Draw::textHeight())/2,text,fg);
         // focus indicator
         if(focused && !flat) Draw::drawFocusRect(surf,4,4,rect.w-8,rect.h-8);
     }
 
+    bool focusable() const override { return true; }
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
         if(!enabled) return false;
-        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
-        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        if(e.type==EventType::MouseEnter){
+            setState(WidgetState::Hovered);
+            if(!flat) ctx.animateFloat(this,hot,1.f,120);
+            return true;
+        }
+        if(e.type==EventType::MouseLeave){
+            setState(WidgetState::Normal);
+            if(!flat) ctx.animateFloat(this,hot,0.f,250);
+            return true;
+        }
         if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
             setState(WidgetState::Pressed); ctx.setFocus(this); return true;
         }
@@ -780,6 +2807,7 @@ public:
     size_t      selStart=0, selEnd=0;
     int         scrollOff=0; // pixel horizontal scroll
     size_t      maxLen=256;
+    uint32_t    blinkMs=530;     // caret blink half-period, 0 = steady
 
     UITextInput(const std::string& id_, Rect r, const std::string& ph="")
         : UIComponent(id_,r), placeholder(ph) {}
@@ -788,50 +2816,59 @@ public:
     void setText(const std::string& t){ text=t; cursor=t.size(); markDirty(); }
 
     void onDraw() override {
+        syncBlink();
         // Background
         Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::EDIT_BG);
         Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
         // Clip inner area
-        int px=3, py=(rect.h-8)/2;
+        const Font& f=Font::active();
+        int th=f.lineHeight;
+        int px=3, py=(rect.h-th)/2;
         int innerW=rect.w-8;
+        size_t s0=std::min(selStart,selEnd), s1=std::max(selStart,selEnd);
         // Draw selection
-        if(focused && selStart!=selEnd){
-            size_t s=std::min(selStart,selEnd), en=std::max(selStart,selEnd);
-            int sx=px+(int)s*8-scrollOff;
-            int ew=(int)(en-s)*8;
+        if(focused && s0!=s1){
+            int sx=px+xOf(s0)-scrollOff;
+            int ew=xOf(s1)-xOf(s0);
             if(sx<px+innerW && sx+ew>px)
-                Draw::fillRect(surf,std::max(px,sx),py-1,std::min(ew,innerW),10,Pal::SEL_BG);
+                Draw::fillRect(surf,std::max(px,sx),py-1,std::min(ew,innerW),th+2,Pal::SEL_BG);
         }
         // Draw text
-        int tx=px-scrollOff;
         if(text.empty() && !focused && !placeholder.empty())
             Draw::drawText(surf,px,py,placeholder,Pal::DISABLED_TXT);
         else {
-            for(size_t i=0;i<text.size();i++){
-                int cx2=tx+(int)i*8;
-                if(cx2+8<px||cx2>=px+innerW) continue;
-                bool sel=focused&&i>=std::min(selStart,selEnd)&&i<std::max(selStart,selEnd);
-                Draw::drawChar(surf,cx2,py,text[i], sel?Pal::SEL_TXT:Pal::TEXT,
-                               sel?Pal::SEL_BG:Pal::EDIT_BG, !sel);
+            int cx2=px-scrollOff; uint32_t prev=0;
+            for(size_t i=0;i<text.size();){
+                size_t at=i;
+                uint32_t cp=Utf8::decode(text.data(),text.size(),i);
+                if(at) cx2+=f.kerning(prev,cp);
+                int adv=f.advance(cp);
+                prev=cp;
+                if(cx2+adv<px||cx2>=px+innerW){ cx2+=adv; continue; }
+                bool sel=focused&&at>=s0&&at<s1;
+                Draw::drawCodepoint(surf,cx2,py,cp, sel?Pal::SEL_TXT:Pal::TEXT,
+                                    sel?Pal::SEL_BG:Pal::EDIT_BG, !sel);
+                cx2+=adv;
             }
         }
         // Cursor
-        if(focused){
-            int cx2=px+(int)cursor*8-scrollOff;
+        if(focused&&caretOn){
+            int cx2=px+xOf(cursor)-scrollOff;
             if(cx2>=px&&cx2<px+innerW)
-                Draw::drawVLine(surf,cx2,py-1,10,Color{0,0,0});
+                Draw::drawVLine(surf,cx2,py-1,th+2,Color{0,0,0});
         }
     }
 
+    bool focusable() const override { return true; }
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
         if(!enabled) return false;
         if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
             ctx.setFocus(this);
             // place cursor
             int rel=e.mx-rect.x-3+scrollOff;
-            cursor=(size_t)std::max(0,std::min((int)text.size(), rel/8));
+            cursor=Font::active().indexAt(text,rel);
             selStart=selEnd=cursor;
-            markDirty(); return true;
+            showCaret(); markDirty(); return true;
         }
         if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
         if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
@@ -846,38 +2883,62 @@ public:
                 text.insert(cursor,ins); cursor+=ins.size(); selStart=selEnd=cursor;
                 UIEvent ve; ve.type=EventType::ValueChanged; ve.svalue=text; emit(ve);
             }
-            scrollToShowCursor(); markDirty(); return true;
+            scrollToShowCursor(); showCaret(); markDirty(); return true;
         }
         if(e.type==EventType::KeyDown && focused){
             switch(e.key){
-                case SDLK_LEFT:  if(cursor>0){cursor--;} selStart=selEnd=cursor; break;
-                case SDLK_RIGHT: if(cursor<text.size()){cursor++;} selStart=selEnd=cursor; break;
+                case SDLK_LEFT:  cursor=Utf8::prev(text,cursor); selStart=selEnd=cursor; break;
+                case SDLK_RIGHT: cursor=Utf8::next(text,cursor); selStart=selEnd=cursor; break;
                 case SDLK_HOME:  cursor=0; selStart=selEnd=cursor; break;
                 case SDLK_END:   cursor=text.size(); selStart=selEnd=cursor; break;
                 case SDLK_BACKSPACE:
                     if(selStart!=selEnd){ size_t s=std::min(selStart,selEnd),en=std::max(selStart,selEnd); text.erase(s,en-s); cursor=s; selStart=selEnd=cursor; }
-                    else if(cursor>0){ text.erase(cursor-1,1); cursor--; selStart=selEnd=cursor; }
+                    else if(cursor>0){ size_t p=Utf8::prev(text,cursor); text.erase(p,cursor-p); cursor=p; selStart=selEnd=cursor; }
                     { UIEvent ve; ve.type=EventType::ValueChanged; ve.svalue=text; emit(ve); }
                     break;
                 case SDLK_DELETE:
-                    if(cursor<text.size()){ text.erase(cursor,1); UIEvent ve; ve.type=EventType::ValueChanged; ve.svalue=text; emit(ve); }
+                    if(cursor<text.size()){ text.erase(cursor,Utf8::next(text,cursor)-cursor); UIEvent ve; ve.type=EventType::ValueChanged; ve.svalue=text; emit(ve); }
                     break;
                 case SDLK_a:
                     if(e.mod&KMOD_CTRL){ selStart=0; selEnd=cursor=text.size(); }
                     break;
                 default: break;
             }
-            scrollToShowCursor(); markDirty(); return true;
+            scrollToShowCursor(); showCaret(); markDirty(); return true;
         }
         return false;
     }
 
 private:
+    TimerId blinkTimer=0;
+    bool    caretOn=true;
+
+    // Runs the blink timer only while focused
+    void syncBlink(){
+        if(!context) blinkTimer=0;      // owner timers die with the registration
+        if(focused&&!blinkTimer&&blinkMs&&context)
+            blinkTimer=context->setInterval(blinkMs,[this]{ caretOn=!caretOn; markDirty(); },this);
+        else if(!focused&&blinkTimer){
+            if(context) context->clearTimer(blinkTimer);
+            blinkTimer=0; caretOn=true;
+        }
+    }
+
+    // Solid caret after input; the blink restarts from the next draw
+    void showCaret(){
+        caretOn=true;
+        if(blinkTimer&&context) context->clearTimer(blinkTimer);
+        blinkTimer=0;
+    }
+
+    // Pixel offset of byte index i from the start of the text
+    int xOf(size_t i) const { return Font::active().measure(text.data(),std::min(i,text.size())); }
+
     void scrollToShowCursor(){
         int innerW=rect.w-8;
-        int cx2=(int)cursor*8-scrollOff;
-        if(cx2<0) scrollOff=(int)cursor*8;
-        if(cx2>=innerW) scrollOff=(int)cursor*8-innerW+8;
+        int cx=xOf(cursor);
+        if(cx-scrollOff<0) scrollOff=cx;
+        if(cx-scrollOff>=innerW) scrollOff=cx-innerW+Font::active().advance(' ');
         if(scrollOff<0) scrollOff=0;
     }
 };
@@ -906,9 +2967,10 @@ public:
         if(focused) Draw::drawFocusRect(surf,1,cy-1,15,15);
         // Label
         Color fg=enabled?Pal::TEXT:Pal::DISABLED_TXT;
-        Draw::drawText(surf,20,(rect.h-8)/2,text,fg);
+        Draw::drawText(surf,20,(rect.h-Draw::textHeight())/2,text,fg);
     }
 
+    bool focusable() const override { return true; }
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
         if(!enabled) return false;
         if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
@@ -951,9 +3013,10 @@ public:
         }
         if(focused) Draw::drawFocusRect(surf,1,cy-1,15,15);
         Color fg=enabled?Pal::TEXT:Pal::DISABLED_TXT;
-        Draw::drawText(surf,20,(rect.h-8)/2,text,fg);
+        Draw::drawText(surf,20,(rect.h-Draw::textHeight())/2,text,fg);
     }
 
+    bool focusable() const override { return true; }
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
         if(!enabled) return false;
         if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
@@ -1008,6 +3071,7 @@ public:
         if(focused) Draw::drawFocusRect(surf,1,1,rect.w-2,rect.h-2);
     }
 
+    bool focusable() const override { return true; }
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
         if(!enabled) return false;
         auto move=[&](int mx2, int my2){
@@ -1041,6 +3105,7 @@ class UISpinner : public UIComponent {
 public:
     float value=0.f, minVal=0.f, maxVal=100.f, step=1.f;
     int   decimals=3;
+    uint32_t repeatDelay=400, repeatRate=50;   // arrow auto-repeat (ms)
 
     UISpinner(const std::string& id_, Rect r, float mn=0.f, float mx=100.f,
               float v=0.f, float s=1.f)
@@ -1068,120 +3133,3079 @@ public:
         if(focused) Draw::drawFocusRect(surf,1,1,rect.w-bw-2,rect.h-2);
     }
 
-    bool onEvent(const UIEvent& e, UIContext& ctx) override {
-        if(!enabled) return false;
-        auto tryChange=[&](float delta){
-            float oldv=value; setValue(value+delta);
-            if(value!=oldv){ UIEvent ve; ve.type=EventType::ValueChanged; ve.fvalue=value; emit(ve); }
-        };
-        if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
-        if(e.type==EventType::MouseLeave){setState(WidgetState::Normal);return true;}
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled){ stopRepeat(); return false; }
+        if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
+        if(e.type==EventType::MouseLeave){stopRepeat();setState(WidgetState::Normal);return true;}
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            int bw=16, half=rect.h/2;
+            int lx=e.mx-rect.x, ly=e.my-rect.y;
+            if(lx>=rect.w-bw){
+                float d=ly<half?+step:-step;
+                tryChange(d);
+                // Held arrow: pause, then repeat until release
+                stopRepeat();
+                repeatTimer=ctx.setTimeout(repeatDelay,[this,&ctx,d]{
+                    repeatTimer=ctx.setInterval(repeatRate,[this,d]{ tryChange(d); },this);
+                    tryChange(d);
+                },this);
+            }
+            return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ stopRepeat(); return true; }
+        if(e.type==EventType::MouseWheel && focused){
+            tryChange(e.wheel*step); return true;
+        }
+        if(e.type==EventType::KeyDown && focused){
+            if(e.key==SDLK_UP)   { tryChange(+step); return true; }
+            if(e.key==SDLK_DOWN) { tryChange(-step); return true; }
+        }
+        return false;
+    }
+
+private:
+    TimerId repeatTimer=0;
+
+    void tryChange(float delta){
+        float oldv=value; setValue(value+delta);
+        if(value!=oldv){ UIEvent ve; ve.type=EventType::ValueChanged; ve.fvalue=value; emit(ve); }
+    }
+
+    void stopRepeat(){
+        if(repeatTimer&&context) context->clearTimer(repeatTimer);
+        repeatTimer=0;
+    }
+};
+
+// ─── UIScrollBar ──────────────────────────────────────────────────────────────
+class UIScrollBar : public UIComponent {
+public:
+    bool  horizontal=false;
+    float value=0.f;        // 0..1
+    float thumbRatio=0.2f;  // thumb/track ratio
+    bool  dragging=false;
+    int   dragStart=0;
+    float dragVal=0.f;
+
+    UIScrollBar(const std::string& id_, Rect r, bool horiz=false)
+        : UIComponent(id_,r), horizontal(horiz) {}
+
+    void setValue(float v){ v=std::max(0.f,std::min(1.f,v)); if(v!=value){value=v;markDirty();} }
+    float getValue() const { return value; }
+
+    void onDraw() override {
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::SCROLLBAR_BG);
+        int btnSz=15;
+        if(horizontal){
+            // Left button
+            Draw::fillRect(surf,0,0,btnSz,rect.h,Pal::FACE);
+            Draw::drawBevel(surf,0,0,btnSz,rect.h,true);
+            Draw::drawArrowLeft(surf,4,rect.h/2-3,5,Pal::TEXT);
+            // Right button
+            Draw::fillRect(surf,rect.w-btnSz,0,btnSz,rect.h,Pal::FACE);
+            Draw::drawBevel(surf,rect.w-btnSz,0,btnSz,rect.h,true);
+            Draw::drawArrowRight(surf,rect.w-btnSz+4,rect.h/2-3,5,Pal::TEXT);
+            // Thumb
+            int trackW=rect.w-btnSz*2;
+            int tw=std::max(15,(int)(trackW*thumbRatio));
+            int tx=btnSz+(int)((trackW-tw)*value);
+            Draw::fillRect(surf,tx,1,tw,rect.h-2,Pal::FACE);
+            Draw::drawBevel(surf,tx,1,tw,rect.h-2,true);
+        } else {
+            Draw::fillRect(surf,0,0,rect.w,btnSz,Pal::FACE);
+            Draw::drawBevel(surf,0,0,rect.w,btnSz,true);
+            Draw::drawArrowUp(surf,rect.w/2-3,4,4,Pal::TEXT);
+            Draw::fillRect(surf,0,rect.h-btnSz,rect.w,btnSz,Pal::FACE);
+            Draw::drawBevel(surf,0,rect.h-btnSz,rect.w,btnSz,true);
+            Draw::drawArrowDown(surf,rect.w/2-3,rect.h-btnSz+4,4,Pal::TEXT);
+            int trackH=rect.h-btnSz*2;
+            int th=std::max(15,(int)(trackH*thumbRatio));
+            int ty2=btnSz+(int)((trackH-th)*value);
+            Draw::fillRect(surf,1,ty2,rect.w-2,th,Pal::FACE);
+            Draw::drawBevel(surf,1,ty2,rect.w-2,th,true);
+        }
+    }
+
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        int btnSz=15;
+        auto fireScroll=[&](float v){ setValue(v); UIEvent se; se.type=EventType::Scroll; se.fvalue=value; emit(se); };
+        if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
+        if(e.type==EventType::MouseLeave){setState(WidgetState::Normal);dragging=false;return true;}
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            if(horizontal){
+                int lx=e.mx-rect.x;
+                if(lx<btnSz) fireScroll(std::max(0.f,value-0.1f));
+                else if(lx>rect.w-btnSz) fireScroll(std::min(1.f,value+0.1f));
+                else { dragging=true; dragStart=lx; dragVal=value; }
+            } else {
+                int ly=e.my-rect.y;
+                if(ly<btnSz) fireScroll(std::max(0.f,value-0.1f));
+                else if(ly>rect.h-btnSz) fireScroll(std::min(1.f,value+0.1f));
+                else { dragging=true; dragStart=ly; dragVal=value; }
+            }
+            return true;
+        }
+        if(e.type==EventType::MouseMove && dragging){
+            int trackSz=(horizontal?rect.w:rect.h)-btnSz*2;
+            int thumbSz=std::max(15,(int)(trackSz*thumbRatio));
+            int travel=trackSz-thumbSz;
+            if(travel>0){
+                int delta=horizontal?(e.mx-rect.x-dragStart):(e.my-rect.y-dragStart);
+                fireScroll(std::max(0.f,std::min(1.f,dragVal+(float)delta/travel)));
+            }
+            return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
+        if(e.type==EventType::MouseWheel){
+            fireScroll(std::max(0.f,std::min(1.f,value-e.wheel*0.1f))); return true;
+        }
+        return false;
+    }
+};
+
+// ─── TextBuffer (gap buffer + incremental line index) ─────────────────────────
+// Text lives in a single byte array with a movable gap at the edit point, so
+// typing and deleting near the cursor never shifts the rest of the document.
+// Line starts are split at the gap the same way: starts before the gap are
+// kept as absolute offsets, starts after it as distances from the end of the
+// text. Neither half changes when bytes are inserted or removed at the gap,
+// so an edit only pushes/pops the starts of the newlines it touches.
+class TextBuffer {
+public:
+    TextBuffer(){ clear(); }
+
+    size_t size() const { return buf.size()-(gapEnd-gapStart); }
+    bool   empty() const { return size()==0; }
+
+    char at(size_t i) const { return i<gapStart?buf[i]:buf[i+(gapEnd-gapStart)]; }
+
+    void clear(){
+        buf.assign(64,0); gapStart=0; gapEnd=buf.size();
+        before.assign(1,0); after.clear();
+    }
+
+    void setText(const std::string& s){ clear(); insert(0,s.data(),s.size()); }
+
+    void insert(size_t pos, const char* s, size_t n){
+        if(!n) return;
+        moveGap(std::min(pos,size()));
+        reserveGap(n);
+        for(size_t i=0;i<n;i++){
+            buf[gapStart++]=s[i];
+            if(s[i]=='\n') before.push_back(gapStart);
+        }
+    }
+
+    void erase(size_t pos, size_t n){
+        if(pos>=size()) return;
+        n=std::min(n,size()-pos);
+        moveGap(pos);
+        for(size_t i=0;i<n;i++)
+            if(buf[gapEnd+i]=='\n') after.pop_back();
+        gapEnd+=n;
+    }
+
+    // Copy [pos,pos+n) into out (reuses out's capacity)
+    void copy(size_t pos, size_t n, std::string& out) const {
+        out.clear();
+        if(pos>=size()) return;
+        n=std::min(n,size()-pos);
+        out.reserve(n);
+        size_t e=pos+n;
+        if(pos<gapStart) out.append(&buf[pos],std::min(e,gapStart)-pos);
+        if(e>gapStart){
+            size_t g=gapEnd-gapStart, a=std::max(pos,gapStart);
+            out.append(&buf[a+g],e-a);
+        }
+    }
+
+    std::string substr(size_t pos, size_t n) const { std::string s; copy(pos,n,s); return s; }
+    std::string str() const { return substr(0,size()); }
+
+    // ── Lines ────────────────────────────────────────────────────────────
+    size_t lineCount() const { return before.size()+after.size(); }
+
+    size_t lineStart(size_t line) const {
+        if(line<before.size()) return before[line];
+        size_t k=line-before.size();
+        if(k>=after.size()) return size();
+        return size()-after[after.size()-1-k];
+    }
+
+    // End of line (excluding its '\n')
+    size_t lineEnd(size_t line) const {
+        return line+1<lineCount()?lineStart(line+1)-1:size();
+    }
+
+    size_t lineOf(size_t pos) const {
+        if(after.empty()||pos<size()-after.back())
+            return (size_t)(std::upper_bound(before.begin(),before.end(),pos)-before.begin())-1;
+        // after is ascending in distance-from-end, i.e. descending in offset
+        size_t idx=std::lower_bound(after.begin(),after.end(),size()-pos)-after.begin();
+        return before.size()+(after.size()-1-idx);
+    }
+
+private:
+    std::vector<char>   buf;
+    size_t              gapStart=0, gapEnd=0;
+    std::vector<size_t> before;  // absolute line starts <= gapStart, ascending
+    std::vector<size_t> after;   // size()-start for starts > gapStart; back() is nearest the gap
+
+    void moveGap(size_t pos){
+        if(pos<gapStart){
+            size_t n=gapStart-pos;
+            std::memmove(&buf[gapEnd-n],&buf[pos],n);
+            gapStart-=n; gapEnd-=n;
+            while(before.back()>pos){ after.push_back(size()-before.back()); before.pop_back(); }
+        } else if(pos>gapStart){
+            size_t n=pos-gapStart;
+            std::memmove(&buf[gapStart],&buf[gapEnd],n);
+            gapStart+=n; gapEnd+=n;
+            while(!after.empty()&&size()-after.back()<=pos){ before.push_back(size()-after.back()); after.pop_back(); }
+        }
+    }
+
+    void reserveGap(size_t n){
+        if(gapEnd-gapStart>=n) return;
+        size_t tail=buf.size()-gapEnd;
+        size_t cap=std::max(buf.size()*2,size()+n+64);
+        std::vector<char> nb(cap);
+        if(gapStart) std::memcpy(&nb[0],&buf[0],gapStart);
+        if(tail) std::memcpy(&nb[cap-tail],&buf[gapEnd],tail);
+        buf.swap(nb);
+        gapEnd=cap-tail;
+    }
+};
+
+// ─── UITextEditor (multi-line, virtualized) ──────────────────────────────────
+// Only the lines inside the viewport are copied out of the buffer and drawn,
+// so the cost of a keystroke depends on the view height, not the document.
+class UITextEditor : public UIComponent {
+public:
+    TextBuffer   buffer;
+    size_t       cursor=0;
+    size_t       anchor=0;      // selection = [min(anchor,cursor), max(..))
+    size_t       topLine=0;
+    int          scrollX=0;     // pixel horizontal scroll
+    bool         readOnly=false;
+    UIScrollBar* vbar=nullptr;
+
+    static const int SB=16;
+
+    UITextEditor(const std::string& id_, Rect r, UIContext& ctx)
+        : UIComponent(id_,r) {
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",barRect())),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            size_t maxTop=maxTopLine();
+            size_t t=(size_t)(e.fvalue*maxTop+0.5f);
+            if(t!=topLine){ topLine=t; markDirty(); }
+        });
+        syncBar();
+    }
+
+    std::string getText() const { return buffer.str(); }
+    void setText(const std::string& t){
+        buffer.setText(t); cursor=anchor=0; topLine=0; scrollX=0;
+        syncBar(); markDirty();
+    }
+
+    bool   hasSelection() const { return cursor!=anchor; }
+    size_t selMin() const { return std::min(cursor,anchor); }
+    size_t selMax() const { return std::max(cursor,anchor); }
+    std::string selectedText() const { return buffer.substr(selMin(),selMax()-selMin()); }
+
+    void select(size_t a, size_t c){
+        anchor=std::min(a,buffer.size()); cursor=std::min(c,buffer.size());
+        ensureCursorVisible(); markDirty();
+    }
+
+    void insertText(const char* s, size_t n){
+        if(hasSelection()) eraseSelection();
+        buffer.insert(cursor,s,n); cursor+=n; anchor=cursor;
+        changed();
+    }
+
+    int visibleLines() const { return std::max(1,(rect.h-4)/Font::active().lineHeight); }
+
+    void onDraw() override {
+        if(vbar){ Rect br=barRect(); vbar->setRect(br); }
+        const Font& f=Font::active();
+        int lh=f.lineHeight;
+        int px=3, py=2;
+        int innerW=textW();
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::EDIT_BG);
+
+        size_t s0=selMin(), s1=selMax();
+        size_t last=std::min(buffer.lineCount(),topLine+(size_t)visibleLines()+1);
+        for(size_t ln=topLine;ln<last;ln++){
+            size_t ls=buffer.lineStart(ln), le=buffer.lineEnd(ln);
+            buffer.copy(ls,le-ls,line);
+            int y=py+(int)(ln-topLine)*lh;
+            // Selection background (a selected newline shows as one space)
+            if(s0!=s1 && s0<=le && s1>ls){
+                size_t a=std::max(s0,ls)-ls, b=std::min(s1,le)-ls;
+                int x0=f.measure(line.data(),a), x1=f.measure(line.data(),b);
+                if(s1>le) x1+=f.advance(' ');
+                int l=std::max(0,px+x0-scrollX), r=std::min(px+innerW,px+x1-scrollX);
+                if(r>l) Draw::fillRect(surf,l,y,r-l,lh,focused?Pal::SEL_BG:Pal::FACE);
+            }
+            // Glyphs, skipping those scrolled out horizontally
+            int x=px-scrollX; uint32_t prev=0;
+            for(size_t i=0;i<line.size();){
+                size_t at=i;
+                uint32_t cp=Utf8::decode(line.data(),line.size(),i);
+                if(at) x+=f.kerning(prev,cp);
+                prev=cp;
+                int adv=cp=='\t'?f.advance(' ')*4:f.advance(cp);
+                if(x>=px+innerW) break;
+                if(x+adv>px && cp!='\t'){
+                    bool sel=focused&&ls+at>=s0&&ls+at<s1;
+                    Draw::drawCodepoint(surf,x,y,cp,sel?Pal::SEL_TXT:Pal::TEXT,Pal::EDIT_BG,true);
+                }
+                x+=adv;
+            }
+        }
+        // Caret
+        if(focused){
+            size_t cl=buffer.lineOf(cursor);
+            if(cl>=topLine && cl<last){
+                int cx=px+columnX(cl,cursor)-scrollX;
+                if(cx>=px-1&&cx<px+innerW)
+                    Draw::drawVLine(surf,cx,py+(int)(cl-topLine)*lh,lh,Color{0,0,0});
+            }
+        }
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
+        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            cursor=posAt(e.mx,e.my);
+            if(!(SDL_GetModState()&KMOD_SHIFT)) anchor=cursor;
+            dragging=true; prefX=-1;
+            markDirty(); return true;
+        }
+        if(e.type==EventType::MouseMove && dragging){
+            size_t p=posAt(e.mx,e.my);
+            if(p!=cursor){ cursor=p; ensureCursorVisible(); markDirty(); }
+            return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
+        if(e.type==EventType::DblClick){
+            selectWordAt(posAt(e.mx,e.my)); return true;
+        }
+        if(e.type==EventType::MouseWheel){
+            scrollTo((long)topLine-e.wheel*3); return true;
+        }
+        if(e.type==EventType::TextInput && focused && e.text && !readOnly){
+            insertText(e.text,std::strlen(e.text)); prefX=-1; return true;
+        }
+        if(e.type==EventType::KeyDown && focused) return onKey(e);
+        return false;
+    }
+
+private:
+    bool        dragging=false;
+    int         prefX=-1;       // remembered caret x for vertical moves
+    mutable std::string line;   // scratch for the line being drawn/measured
+
+    Rect barRect() const { return Rect(rect.w-SB,0,SB,rect.h); }
+    int  textW() const { return rect.w-SB-6; }
+
+    size_t maxTopLine() const {
+        size_t n=buffer.lineCount(), v=(size_t)visibleLines();
+        return n>v?n-v:0;
+    }
+
+    void syncBar(){
+        if(!vbar) return;
+        size_t n=buffer.lineCount(), v=(size_t)visibleLines();
+        vbar->thumbRatio=n>v?(float)v/n:1.f;
+        size_t m=maxTopLine();
+        vbar->setValue(m?(float)topLine/m:0.f);
+        vbar->markDirty();
+    }
+
+    void scrollTo(long t){
+        long m=(long)maxTopLine();
+        t=std::max(0L,std::min(m,t));
+        if((size_t)t!=topLine){ topLine=(size_t)t; syncBar(); markDirty(); }
+    }
+
+    // Pixel x of byte pos within line ln
+    int columnX(size_t ln, size_t pos) const {
+        size_t ls=buffer.lineStart(ln);
+        buffer.copy(ls,pos-ls,line);
+        return lineWidth(line,line.size());
+    }
+
+    int lineWidth(const std::string& s, size_t n) const {
+        const Font& f=Font::active();
+        int w=0; uint32_t prev=0;
+        for(size_t i=0;i<n;){
+            size_t at=i;
+            uint32_t cp=Utf8::decode(s.data(),n,i);
+            if(at) w+=f.kerning(prev,cp);
+            prev=cp;
+            w+=cp=='\t'?f.advance(' ')*4:f.advance(cp);
+        }
+        return w;
+    }
+
+    // Byte offset in line ln closest to pixel x
+    size_t posInLine(size_t ln, int x) const {
+        size_t ls=buffer.lineStart(ln), le=buffer.lineEnd(ln);
+        buffer.copy(ls,le-ls,line);
+        const Font& f=Font::active();
+        int w=0; uint32_t prev=0;
+        for(size_t i=0;i<line.size();){
+            size_t at=i;
+            uint32_t cp=Utf8::decode(line.data(),line.size(),i);
+            if(at) w+=f.kerning(prev,cp);
+            prev=cp;
+            int adv=cp=='\t'?f.advance(' ')*4:f.advance(cp);
+            if(x<w+adv/2) return ls+at;
+            w+=adv;
+        }
+        return le;
+    }
+
+    size_t posAt(int mx, int my) const {
+        int row=(my-rect.y-2)/Font::active().lineHeight;
+        if(my-rect.y-2<0) row=-1;
+        long ln=(long)topLine+row;
+        if(ln<0) return 0;
+        if((size_t)ln>=buffer.lineCount()) return buffer.size();
+        return posInLine((size_t)ln,mx-rect.x-3+scrollX);
+    }
+
+    void ensureCursorVisible(){
+        size_t cl=buffer.lineOf(cursor);
+        size_t v=(size_t)visibleLines();
+        if(cl<topLine) topLine=cl;
+        else if(cl>=topLine+v) topLine=cl-v+1;
+        int cx=columnX(cl,cursor), w=textW();
+        if(cx-scrollX<0) scrollX=std::max(0,cx-w/4);
+        else if(cx-scrollX>=w) scrollX=cx-w+w/4;
+        syncBar();
+    }
+
+    void eraseSelection(){
+        size_t a=selMin();
+        buffer.erase(a,selMax()-a);
+        cursor=anchor=a;
+    }
+
+    void changed(){
+        ensureCursorVisible(); markDirty();
+        UIEvent ve; ve.type=EventType::ValueChanged; ve.ivalue=(int)buffer.size(); emit(ve);
+    }
+
+    static bool isWordChar(char c){ return std::isalnum((unsigned char)c)||c=='_'||((unsigned char)c&0x80); }
+
+    void selectWordAt(size_t p){
+        size_t a=p, b=p;
+        while(a>0&&isWordChar(buffer.at(a-1))) a--;
+        while(b<buffer.size()&&isWordChar(buffer.at(b))) b++;
+        anchor=a; cursor=b; markDirty();
+    }
+
+    // UTF-8 stepping on the buffer (continuation bytes are 10xxxxxx)
+    size_t nextPos(size_t p) const {
+        if(p>=buffer.size()) return buffer.size();
+        p++;
+        while(p<buffer.size()&&((unsigned char)buffer.at(p)&0xC0)==0x80) p++;
+        return p;
+    }
+    size_t prevPos(size_t p) const {
+        if(p==0) return 0;
+        p--;
+        while(p>0&&((unsigned char)buffer.at(p)&0xC0)==0x80) p--;
+        return p;
+    }
+
+    void moveVert(long dl){
+        size_t cl=buffer.lineOf(cursor);
+        if(prefX<0) prefX=columnX(cl,cursor);
+        long nl=(long)cl+dl;
+        if(nl<0){ cursor=0; return; }
+        if((size_t)nl>=buffer.lineCount()){ cursor=buffer.size(); return; }
+        cursor=posInLine((size_t)nl,prefX);
+    }
+
+    bool onKey(const UIEvent& e){
+        bool shift=(e.mod&KMOD_SHIFT)!=0, ctrl=(e.mod&KMOD_CTRL)!=0;
+        bool vert=false, moved=true;
+        size_t cl=buffer.lineOf(cursor);
+        switch(e.key){
+            case SDLK_LEFT:
+                if(hasSelection()&&!shift) cursor=selMin(); else cursor=prevPos(cursor);
+                break;
+            case SDLK_RIGHT:
+                if(hasSelection()&&!shift) cursor=selMax(); else cursor=nextPos(cursor);
+                break;
+            case SDLK_UP:       moveVert(-1); vert=true; break;
+            case SDLK_DOWN:     moveVert(1);  vert=true; break;
+            case SDLK_PAGEUP:   moveVert(-(long)visibleLines()); vert=true; break;
+            case SDLK_PAGEDOWN: moveVert((long)visibleLines());  vert=true; break;
+            case SDLK_HOME: cursor=ctrl?0:buffer.lineStart(cl); break;
+            case SDLK_END:  cursor=ctrl?buffer.size():buffer.lineEnd(cl); break;
+            case SDLK_a:
+                if(!ctrl) return true;
+                anchor=0; cursor=buffer.size(); markDirty(); return true;
+            case SDLK_c:
+                if(ctrl&&hasSelection()) SDL_SetClipboardText(selectedText().c_str());
+                return true;
+            case SDLK_x:
+                if(ctrl&&hasSelection()&&!readOnly){
+                    SDL_SetClipboardText(selectedText().c_str());
+                    eraseSelection(); changed();
+                }
+                return true;
+            case SDLK_v:
+                if(ctrl&&!readOnly&&SDL_HasClipboardText()){
+                    char* t=SDL_GetClipboardText();
+                    if(t){ insertText(t,std::strlen(t)); SDL_free(t); }
+                }
+                prefX=-1; return true;
+            case SDLK_RETURN: case SDLK_KP_ENTER:
+                if(!readOnly) insertText("\n",1);
+                prefX=-1; return true;
+            case SDLK_BACKSPACE:
+                if(readOnly) return true;
+                if(hasSelection()) eraseSelection();
+                else if(cursor>0){ size_t p=prevPos(cursor); buffer.erase(p,cursor-p); cursor=anchor=p; }
+                prefX=-1; changed(); return true;
+            case SDLK_DELETE:
+                if(readOnly) return true;
+                if(hasSelection()) eraseSelection();
+                else if(cursor<buffer.size()) buffer.erase(cursor,nextPos(cursor)-cursor);
+                prefX=-1; changed(); return true;
+            default: moved=false; break;
+        }
+        if(moved){
+            if(!shift) anchor=cursor;
+            if(!vert) prefX=-1;
+            ensureCursorVisible(); markDirty();
+        }
+        return true;
+    }
+};
+
+// ─── UILogView (append-only console) ─────────────────────────────────────────
+// Lines live in a fixed-capacity ring; the oldest are dropped once it is full.
+// append() may be called from any thread. While following the tail, new
+// lines scroll the retained surface up with one memmove and only the new
+// rows are rasterised.
+class UILogView : public UIComponent {
+public:
+    bool         autoScroll=true;   // keep the newest line in view
+    UIScrollBar* vbar=nullptr;
+
+    static const int SB=16;
+
+    UILogView(const std::string& id_, Rect r, UIContext& ctx, size_t capacity=10000)
+        : UIComponent(id_,r), cap(std::max<size_t>(1,capacity)) {
+        bgColor=Pal::EDIT_BG;
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",barRect())),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            uint64_t m=maxTop();
+            scrollTo(firstSeq+(uint64_t)(e.fvalue*(m-firstSeq)+0.5f));
+        });
+    }
+
+    // Thread-safe. Text containing '\n' becomes several lines.
+    void append(const std::string& s, Color c=Pal::TEXT){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            pending.push_back(Line{s,c});
+        }
+        postInvalidate();
+    }
+
+    // UI thread only
+    void clear(){
+        { std::lock_guard<std::mutex> lk(mtx); pending.clear(); }
+        ring.clear(); firstSeq=endSeq=top=0; following=true;
+        repaint=true; syncBar(); markDirty();
+    }
+
+    size_t lineCount() const { return (size_t)(endSeq-firstSeq); }
+    size_t capacity()  const { return cap; }
+
+    // Text/colour of the i-th stored line (0 = oldest)
+    const std::string& lineText(size_t i) const { return ring[(size_t)((firstSeq+i)%cap)].text; }
+    Color lineColor(size_t i) const { return ring[(size_t)((firstSeq+i)%cap)].color; }
+
+    int visibleRows() const { return std::max(1,(rect.h-PAD*2)/Font::active().lineHeight); }
+
+    void onDraw() override {
+        drain();
+        if(vbar) vbar->setRect(barRect());
+        const Font& f=Font::active();
+        int lh=f.lineHeight, vis=visibleRows();
+        uint64_t end=std::min(endSeq,top+(uint64_t)vis);
+        bool reuse=!repaint && drawnSurf==surf && drawnW==rect.w && drawnH==rect.h
+                && top>=drawnTop && top-drawnTop<(uint64_t)vis;
+        uint64_t from=top;
+        if(reuse){
+            int shift=(int)(top-drawnTop);
+            if(shift>0){
+                // Slide the text area up by whole rows; the bar is re-blitted on top
+                uint8_t* base=(uint8_t*)surf->pixels+PAD*surf->pitch;
+                std::memmove(base,base+shift*lh*surf->pitch,(size_t)(vis-shift)*lh*surf->pitch);
+                Draw::fillRect(surf,2,PAD+(vis-shift)*lh,textW()+PAD,shift*lh,bgColor);
+            }
+            from=std::max(drawnEnd,top);
+        } else {
+            Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor);
+            Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+        }
+        for(uint64_t q=from;q<end;q++){
+            const Line& L=ring[(size_t)(q%cap)];
+            Draw::drawText(surf,PAD+1,PAD+(int)(q-top)*lh,L.text,L.color);
+        }
+        drawnTop=top; drawnEnd=end; drawnSurf=surf; drawnW=rect.w; drawnH=rect.h;
+        repaint=false;
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
+        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){ ctx.setFocus(this); return true; }
+        if(e.type==EventType::MouseWheel){
+            long d=-e.wheel*3;
+            scrollTo(d<0&&top-firstSeq<(uint64_t)-d?firstSeq:top+d);
+            return true;
+        }
+        if(e.type==EventType::KeyDown && focused){
+            uint64_t page=(uint64_t)visibleRows();
+            switch(e.key){
+                case SDLK_UP:       scrollTo(top>firstSeq?top-1:top); break;
+                case SDLK_DOWN:     scrollTo(top+1); break;
+                case SDLK_PAGEUP:   scrollTo(top-firstSeq>page?top-page:firstSeq); break;
+                case SDLK_PAGEDOWN: scrollTo(top+page); break;
+                case SDLK_HOME:     scrollTo(firstSeq); break;
+                case SDLK_END:      scrollTo(maxTop()); break;
+                default: return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Line { std::string text; Color color; };
+    static const int PAD=2;
+
+    size_t            cap;
+    std::vector<Line> ring;              // grows to cap, then reused in place
+    uint64_t          firstSeq=0, endSeq=0;
+    uint64_t          top=0;             // sequence number of the first visible line
+    bool              following=true;
+
+    std::mutex        mtx;
+    std::vector<Line> pending, incoming; // producer queue / UI-side swap buffer
+
+    // What the retained surface currently shows
+    SDL_Surface*      drawnSurf=nullptr;
+    int               drawnW=0, drawnH=0;
+    uint64_t          drawnTop=0, drawnEnd=0;
+    bool              repaint=true;
+
+    Rect barRect() const { return Rect(rect.w-SB,0,SB,rect.h); }
+    int  textW() const { return rect.w-SB-PAD*2; }
+
+    uint64_t maxTop() const {
+        uint64_t v=(uint64_t)visibleRows();
+        return endSeq-firstSeq>v?endSeq-v:firstSeq;
+    }
+
+    void push(const char* s, size_t n, Color c){
+        if(ring.size()<cap) ring.push_back(Line());
+        Line& L=ring[(size_t)(endSeq%cap)];
+        L.text.assign(s,n); L.color=c;
+        endSeq++;
+        if(endSeq-firstSeq>cap) firstSeq++;
+    }
+
+    void drain(){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if(pending.empty()) return;
+            pending.swap(incoming);
+        }
+        for(auto& L: incoming){
+            const std::string& t=L.text;
+            size_t p=0, nl;
+            while((nl=t.find('\n',p))!=std::string::npos){ push(t.data()+p,nl-p,L.color); p=nl+1; }
+            push(t.data()+p,t.size()-p,L.color);
+        }
+        incoming.clear();
+        if(following&&autoScroll) top=maxTop();
+        if(top<firstSeq) top=firstSeq;
+        syncBar();
+    }
+
+    void scrollTo(uint64_t t){
+        t=std::max(firstSeq,std::min(maxTop(),t));
+        following=t==maxTop();
+        if(t!=top){ top=t; syncBar(); markDirty(); }
+    }
+
+    void syncBar(){
+        if(!vbar) return;
+        uint64_t n=endSeq-firstSeq, v=(uint64_t)visibleRows();
+        vbar->thumbRatio=n>v?(float)v/n:1.f;
+        uint64_t m=maxTop()-firstSeq;
+        vbar->setValue(m?(float)(top-firstSeq)/m:0.f);
+    }
+};
+
+// ─── UIListView (virtualized, data-source driven) ────────────────────────────
+// Rows are pulled on demand from rowCount/rowData. Only the rows in view are
+// fetched and drawn, into a small pool of ListRow slots that is reused as the
+// view scrolls, so the cost of a frame is independent of the row count.
+// Selection is kept as sorted [first,last) ranges so "select all" on a
+// million rows is a single entry.
+struct ListRow {
+    std::string  text;
+    Color        color=Pal::TEXT;
+    SDL_Surface* icon=nullptr;     // optional, not owned; drawn left of the text
+};
+
+class UIListView : public UIComponent {
+public:
+    std::function<int()>               rowCount;
+    std::function<void(int,ListRow&)>  rowData;
+
+    bool         multiSelect=false;
+    int          current=-1;       // keyboard focus row
+    UIScrollBar* vbar=nullptr;
+
+    static const int SB=16;
+
+    UIListView(const std::string& id_, Rect r, UIContext& ctx)
+        : UIComponent(id_,r) {
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",barRect())),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            int m=maxTop();
+            int t=(int)(e.fvalue*m+0.5f);
+            if(t!=top){ top=t; markDirty(); }
+        });
+    }
+
+    int count() const { return rowCount?std::max(0,rowCount()):0; }
+    int rowHeight() const { return Font::active().lineHeight+4; }
+    int visibleRows() const { return std::max(1,(rect.h-4)/rowHeight()); }
+    int topRow() const { return top; }
+
+    // Call after the data source changed (rows added, removed or edited)
+    void refresh(){
+        for(auto& s: pool) s.row=-1;
+        int n=count();
+        clipSelection(n);
+        if(current>=n) current=n-1;
+        top=std::max(0,std::min(top,maxTop()));
+        syncBar(); markDirty();
+    }
+
+    // ── Selection ────────────────────────────────────────────────────────
+    bool isSelected(int i) const {
+        auto it=std::upper_bound(sel.begin(),sel.end(),std::make_pair(i,INT_MAX));
+        if(it==sel.begin()) return false;
+        --it; return i<it->second;
+    }
+    int  selectedRow() const { return sel.empty()?-1:sel.front().first; }
+    const std::vector<std::pair<int,int>>& selectionRanges() const { return sel; }
+
+    void clearSelection(){ if(!sel.empty()){ sel.clear(); markDirty(); } }
+    void selectRange(int a, int b){ addRange(std::max(0,a),std::min(count(),b)); markDirty(); }
+    void select(int i){ sel.clear(); if(i>=0&&i<count()) addRange(i,i+1); setCurrent(i); }
+    void setCurrent(int i){
+        current=std::max(-1,std::min(i,count()-1));
+        ensureVisible(current); markDirty();
+    }
+
+    void ensureVisible(int i){
+        if(i<0) return;
+        int v=visibleRows();
+        if(i<top) top=i; else if(i>=top+v) top=i-v+1;
+        syncBar();
+    }
+
+    void onDraw() override {
+        if(vbar) vbar->setRect(barRect());
+        int n=count(), rh=rowHeight(), v=visibleRows();
+        top=std::max(0,std::min(top,maxTop()));
+        syncBar();
+        if((int)pool.size()<v+1) pool.resize(v+1);
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::EDIT_BG);
+        int w=rect.w-SB-4;
+        int last=std::min(n,top+v);
+        const Font& f=Font::active();
+        for(int r=top;r<last;r++){
+            Slot& s=pool[r%pool.size()];
+            if(s.row!=r){
+                s.data.text.clear(); s.data.color=Pal::TEXT; s.data.icon=nullptr;
+                if(rowData) rowData(r,s.data);
+                s.row=r;
+            }
+            int y=2+(r-top)*rh;
+            bool selr=isSelected(r);
+            if(selr) Draw::fillRect(surf,2,y,w,rh,focused?Pal::SEL_BG:Pal::FACE);
+            int x=4;
+            if(s.data.icon){
+                SDL_Rect dst={x,y+(rh-s.data.icon->h)/2,s.data.icon->w,s.data.icon->h};
+                SDL_BlitSurface(s.data.icon,nullptr,surf,&dst);
+                x+=s.data.icon->w+3;
+            }
+            Draw::drawText(surf,x,y+(rh-f.lineHeight)/2,s.data.text,
+                           selr&&focused?Pal::SEL_TXT:s.data.color);
+            if(focused&&r==current) Draw::drawFocusRect(surf,2,y,w,rh);
+        }
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
+        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            int r=rowAt(e.my);
+            if(r<0) return true;
+            int m=SDL_GetModState();
+            if(multiSelect&&(m&KMOD_SHIFT)&&anchor>=0){ sel.clear(); addRange(std::min(anchor,r),std::max(anchor,r)+1); }
+            else if(multiSelect&&(m&KMOD_CTRL)){ toggle(r); anchor=r; }
+            else { sel.clear(); addRange(r,r+1); anchor=r; }
+            setCurrent(r); changed();
+            return true;
+        }
+        if(e.type==EventType::DblClick){
+            int r=rowAt(e.my);
+            if(r>=0){ UIEvent ce; ce.type=EventType::DblClick; ce.ivalue=r; emit(ce); }
+            return true;
+        }
+        if(e.type==EventType::MouseWheel){
+            int t=std::max(0,std::min(maxTop(),top-e.wheel*3));
+            if(t!=top){ top=t; syncBar(); markDirty(); }
+            return true;
+        }
+        if(e.type==EventType::KeyDown && focused) return onKey(e);
+        return false;
+    }
+
+private:
+    struct Slot { int row=-1; ListRow data; };
+    std::vector<Slot>                pool;   // recycled row state, indexed by row % size
+    std::vector<std::pair<int,int>>  sel;    // sorted, disjoint [first,last)
+    int                              top=0;
+    int                              anchor=-1;
+
+    Rect barRect() const { return Rect(rect.w-SB,0,SB,rect.h); }
+    int  maxTop() const { return std::max(0,count()-visibleRows()); }
+
+    int rowAt(int my) const {
+        int ly=my-rect.y-2;
+        if(ly<0) return -1;
+        int r=top+ly/rowHeight();
+        return r<count()?r:-1;
+    }
+
+    void syncBar(){
+        if(!vbar) return;
+        int n=count(), v=visibleRows(), m=maxTop();
+        vbar->thumbRatio=n>v?(float)v/n:1.f;
+        vbar->setValue(m?(float)top/m:0.f);
+    }
+
+    void changed(){
+        UIEvent ve; ve.type=EventType::ValueChanged; ve.ivalue=current; emit(ve);
+    }
+
+    void addRange(int a, int b){
+        if(a>=b) return;
+        auto it=std::lower_bound(sel.begin(),sel.end(),std::make_pair(a,INT_MIN));
+        if(it!=sel.begin()&&std::prev(it)->second>=a) --it;
+        auto jt=it;
+        while(jt!=sel.end()&&jt->first<=b){ a=std::min(a,jt->first); b=std::max(b,jt->second); ++jt; }
+        it=sel.erase(it,jt);
+        sel.insert(it,std::make_pair(a,b));
+    }
+
+    void removeRange(int a, int b){
+        std::vector<std::pair<int,int>> out;
+        out.reserve(sel.size()+1);
+        for(auto& r: sel){
+            if(r.second<=a||r.first>=b){ out.push_back(r); continue; }
+            if(r.first<a) out.push_back(std::make_pair(r.first,a));
+            if(r.second>b) out.push_back(std::make_pair(b,r.second));
+        }
+        sel.swap(out);
+    }
+
+    void toggle(int i){ if(isSelected(i)) removeRange(i,i+1); else addRange(i,i+1); }
+
+    void clipSelection(int n){
+        while(!sel.empty()&&sel.back().first>=n) sel.pop_back();
+        if(!sel.empty()&&sel.back().second>n) sel.back().second=n;
+        if(anchor>=n) anchor=-1;
+    }
+
+    bool onKey(const UIEvent& e){
+        int n=count();
+        if(!n) return true;
+        bool shift=(e.mod&KMOD_SHIFT)!=0, ctrl=(e.mod&KMOD_CTRL)!=0;
+        int c=current<0?0:current, v=visibleRows();
+        switch(e.key){
+            case SDLK_UP:       c=std::max(0,c-1); break;
+            case SDLK_DOWN:     c=std::min(n-1,c+1); break;
+            case SDLK_PAGEUP:   c=std::max(0,c-v); break;
+            case SDLK_PAGEDOWN: c=std::min(n-1,c+v); break;
+            case SDLK_HOME:     c=0; break;
+            case SDLK_END:      c=n-1; break;
+            case SDLK_a:
+                if(ctrl&&multiSelect){ sel.clear(); addRange(0,n); markDirty(); changed(); }
+                return true;
+            case SDLK_SPACE:
+                if(ctrl&&multiSelect&&current>=0){ toggle(current); anchor=current; markDirty(); changed(); }
+                return true;
+            case SDLK_RETURN:
+                if(current>=0){ UIEvent ce; ce.type=EventType::DblClick; ce.ivalue=current; emit(ce); }
+                return true;
+            default: return false;
+        }
+        if(multiSelect&&shift){
+            if(anchor<0) anchor=current<0?c:current;
+            sel.clear(); addRange(std::min(anchor,c),std::max(anchor,c)+1);
+        } else if(!(multiSelect&&ctrl)){
+            sel.clear(); addRange(c,c+1); anchor=c;
+        }
+        setCurrent(c); changed();
+        return true;
+    }
+};
+
+// ─── UITreeView (virtualized, lazily expanded) ───────────────────────────────
+// The tree is described by a TreeModel and never copied. The view keeps a
+// flat array of the currently visible rows; expanding a node inserts only its
+// direct children (as parent/index pairs, without querying them) and
+// collapsing erases its visible descendants. Node ids and row data are
+// resolved from the model only for the rows in the viewport.
+class TreeModel {
+public:
+    typedef uint64_t NodeId;
+    static const NodeId ROOT=0;
+
+    virtual ~TreeModel() {}
+    virtual int    childCount(NodeId parent)=0;
+    virtual NodeId child(NodeId parent, int index)=0;
+    virtual void   rowData(NodeId node, ListRow& out)=0;
+};
+
+class UITreeView : public UIComponent {
+public:
+    typedef TreeModel::NodeId NodeId;
+
+    UIScrollBar* vbar=nullptr;
+    int          indent=16;
+
+    static const int SB=16;
+
+    UITreeView(const std::string& id_, Rect r, UIContext& ctx)
+        : UIComponent(id_,r) {
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",barRect())),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            int m=maxTop();
+            int t=(int)(e.fvalue*m+0.5f);
+            if(t!=top){ top=t; markDirty(); }
+        });
+    }
+
+    // The model must outlive the view. Call reset() again after structural changes.
+    void setModel(TreeModel* m){ model=m; reset(); }
+
+    void reset(){
+        rows.clear(); top=0; current=-1;
+        if(model){
+            int n=model->childCount(TreeModel::ROOT);
+            rows.resize(n);
+            for(int i=0;i<n;i++) rows[i]=Row(TreeModel::ROOT,i,0);
+        }
+        syncBar(); markDirty();
+    }
+
+    int rowCount() const { return (int)rows.size(); }
+    int rowHeight() const { return Font::active().lineHeight+4; }
+    int visibleRows() const { return std::max(1,(rect.h-4)/rowHeight()); }
+    int currentRow() const { return current; }
+    NodeId nodeAt(int row){ return row>=0&&row<(int)rows.size()?resolve(rows[row]):TreeModel::ROOT; }
+    NodeId selectedNode(){ return nodeAt(current); }
+    int  depthAt(int row) const { return rows[row].depth; }
+    bool isExpanded(int row) const { return rows[row].expanded; }
+
+    bool expand(int row){
+        if(!model||row<0||row>=(int)rows.size()) return false;
+        Row& r=rows[row];
+        if(r.expanded) return true;
+        NodeId id=resolve(r);
+        int n=model->childCount(id);
+        r.kids=n>0?1:0;
+        if(n<=0) return false;
+        r.expanded=true;
+        int d=r.depth+1;
+        rows.insert(rows.begin()+row+1,(size_t)n,Row(id,0,d));
+        for(int i=0;i<n;i++) rows[row+1+i].index=i;
+        if(current>row) current+=n;
+        syncBar(); markDirty();
+        return true;
+    }
+
+    void collapse(int row){
+        if(row<0||row>=(int)rows.size()||!rows[row].expanded) return;
+        int d=rows[row].depth, e=row+1;
+        while(e<(int)rows.size()&&rows[e].depth>d) e++;
+        rows.erase(rows.begin()+row+1,rows.begin()+e);
+        rows[row].expanded=false;
+        int n=e-row-1;
+        if(current>row&&current<e) current=row;
+        else if(current>=e) current-=n;
+        top=std::max(0,std::min(top,maxTop()));
+        syncBar(); markDirty();
+    }
+
+    void toggle(int row){ if(row>=0&&row<(int)rows.size()){ if(rows[row].expanded) collapse(row); else expand(row); } }
+
+    void setCurrent(int row){
+        current=std::max(-1,std::min(row,(int)rows.size()-1));
+        ensureVisible(current); markDirty();
+        UIEvent ve; ve.type=EventType::ValueChanged; ve.ivalue=current; emit(ve);
+    }
+
+    void ensureVisible(int i){
+        if(i<0) return;
+        int v=visibleRows();
+        if(i<top) top=i; else if(i>=top+v) top=i-v+1;
+        syncBar();
+    }
+
+    void onDraw() override {
+        if(vbar) vbar->setRect(barRect());
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::EDIT_BG);
+        int rh=rowHeight(), v=visibleRows();
+        top=std::max(0,std::min(top,maxTop()));
+        int last=std::min((int)rows.size(),top+v);
+        int w=rect.w-SB-4;
+        const Font& f=Font::active();
+        uint32_t dot=Pal::SHADOW.pack(surf);
+        for(int r=top;r<last;r++){
+            Row& R=rows[r];
+            NodeId id=resolve(R);
+            int y=2+(r-top)*rh, cy=y+rh/2;
+            int bx=4+R.depth*indent;            // left edge of this row's expander cell
+            int mx=bx+indent/2;                 // centre of the expander
+            // Guides for each ancestor level, then the elbow into this node
+            for(int d=0;d<R.depth;d++){
+                int gx=4+d*indent+indent/2;
+                for(int yy=y+((y+gx)&1);yy<y+rh;yy+=2) Draw::setPixel(surf,gx,yy,dot);
+            }
+            for(int xx=mx+1;xx<bx+indent;xx+=2) Draw::setPixel(surf,xx,cy,dot);
+            if(R.kids<0) R.kids=model->childCount(id)>0?1:0;
+            if(R.kids){
+                Draw::fillRect(surf,mx-4,cy-4,9,9,Pal::EDIT_BG);
+                Draw::drawRect(surf,mx-4,cy-4,9,9,Pal::SHADOW);
+                Draw::drawHLine(surf,mx-2,cy,5,Pal::TEXT);
+                if(!R.expanded) Draw::drawVLine(surf,mx,cy-2,5,Pal::TEXT);
+            }
+            // Row content
+            cell.text.clear(); cell.color=Pal::TEXT; cell.icon=nullptr;
+            model->rowData(id,cell);
+            int x=bx+indent+2;
+            if(cell.icon){
+                SDL_Rect dst={x,y+(rh-cell.icon->h)/2,cell.icon->w,cell.icon->h};
+                SDL_BlitSurface(cell.icon,nullptr,surf,&dst);
+                x+=cell.icon->w+3;
+            }
+            bool selr=r==current;
+            int tw=f.measure(cell.text.data(),cell.text.size());
+            if(selr) Draw::fillRect(surf,x-2,y,std::min(tw+4,w-x+4),rh,focused?Pal::SEL_BG:Pal::FACE);
+            Draw::drawText(surf,x,y+(rh-f.lineHeight)/2,cell.text,selr&&focused?Pal::SEL_TXT:cell.color);
+            if(selr&&focused) Draw::drawFocusRect(surf,x-2,y,std::min(tw+4,w-x+4),rh);
+        }
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
+        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            int r=rowAt(e.my);
+            if(r<0) return true;
+            int bx=rect.x+4+rows[r].depth*indent;
+            if(e.mx>=bx&&e.mx<bx+indent) toggle(r);
+            else setCurrent(r);
+            return true;
+        }
+        if(e.type==EventType::DblClick){
+            int r=rowAt(e.my);
+            if(r>=0){
+                toggle(r);
+                UIEvent ce; ce.type=EventType::DblClick; ce.ivalue=r; emit(ce);
+            }
+            return true;
+        }
+        if(e.type==EventType::MouseWheel){
+            int t=std::max(0,std::min(maxTop(),top-e.wheel*3));
+            if(t!=top){ top=t; syncBar(); markDirty(); }
+            return true;
+        }
+        if(e.type==EventType::KeyDown && focused){
+            int n=(int)rows.size();
+            if(!n) return true;
+            int c=current<0?0:current, v=visibleRows();
+            switch(e.key){
+                case SDLK_UP:       setCurrent(std::max(0,c-1)); break;
+                case SDLK_DOWN:     setCurrent(std::min(n-1,c+1)); break;
+                case SDLK_PAGEUP:   setCurrent(std::max(0,c-v)); break;
+                case SDLK_PAGEDOWN: setCurrent(std::min(n-1,c+v)); break;
+                case SDLK_HOME:     setCurrent(0); break;
+                case SDLK_END:      setCurrent(n-1); break;
+                case SDLK_RIGHT:
+                    if(!rows[c].expanded) expand(c);
+                    else if(c+1<n&&rows[c+1].depth>rows[c].depth) setCurrent(c+1);
+                    break;
+                case SDLK_LEFT:
+                    if(rows[c].expanded) collapse(c);
+                    else if(rows[c].depth>0){
+                        int p=c-1;
+                        while(p>0&&rows[p].depth>=rows[c].depth) p--;
+                        setCurrent(p);
+                    }
+                    break;
+                case SDLK_RETURN:
+                    if(current>=0){ UIEvent ce; ce.type=EventType::DblClick; ce.ivalue=current; emit(ce); }
+                    break;
+                default: return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Row {
+        NodeId  parent;
+        NodeId  id=0;
+        int     index;
+        int     depth;
+        bool    expanded=false;
+        bool    resolved=false;
+        int8_t  kids=-1;        // -1 unknown, 0 leaf, 1 has children
+        Row(): parent(0), index(0), depth(0) {}
+        Row(NodeId p, int i, int d): parent(p), index(i), depth(d) {}
+    };
+
+    TreeModel*       model=nullptr;
+    std::vector<Row> rows;      // visible rows in display order
+    int              top=0;
+    int              current=-1;
+    ListRow          cell;      // scratch reused for every drawn row
+
+    Rect barRect() const { return Rect(rect.w-SB,0,SB,rect.h); }
+    int  maxTop() const { return std::max(0,(int)rows.size()-visibleRows()); }
+
+    NodeId resolve(Row& r){
+        if(!r.resolved){ r.id=model->child(r.parent,r.index); r.resolved=true; }
+        return r.id;
+    }
+
+    int rowAt(int my) const {
+        int ly=my-rect.y-2;
+        if(ly<0) return -1;
+        int r=top+ly/rowHeight();
+        return r<(int)rows.size()?r:-1;
+    }
+
+    void syncBar(){
+        if(!vbar) return;
+        int n=(int)rows.size(), v=visibleRows(), m=maxTop();
+        vbar->thumbRatio=n>v?(float)v/n:1.f;
+        vbar->setValue(m?(float)top/m:0.f);
+    }
+};
+
+// ─── UIDataGrid (virtualized rows + columns, background sort) ────────────────
+// Cell text is pulled from a GridModel for the visible window only. Column 0
+// and the header row stay frozen while the rest scrolls. Clicking a header
+// sorts on a worker thread (chunked std::sort + merges across cores); the
+// finished row permutation is swapped in on the UI thread, so the grid keeps
+// drawing the old order meanwhile. GridModel::cellText must therefore be safe
+// to call from a worker thread while a sort is running.
+class GridModel {
+public:
+    virtual ~GridModel() {}
+    virtual int  rowCount()=0;
+    virtual int  columnCount()=0;
+    virtual void header(int col, std::string& out)=0;
+    virtual void cellText(int row, int col, std::string& out)=0;
+};
+
+class UIDataGrid : public UIComponent {
+public:
+    UIScrollBar* vbar=nullptr;
+    UIScrollBar* hbar=nullptr;
+    int          defaultColW=90;
+    int          minColW=20;
+
+    static const int SB=16;
+
+    UIDataGrid(const std::string& id_, Rect r, UIContext& ctx)
+        : UIComponent(id_,r) {
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",vbarRect())),ctx));
+        hbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_hsb",hbarRect(),true)),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            int t=(int)(e.fvalue*maxTop()+0.5f);
+            if(t!=top){ top=t; markDirty(); }
+        });
+        hbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            int x=(int)(e.fvalue*maxScrollX()+0.5f);
+            if(x!=scrollX){ scrollX=x; markDirty(); }
+        });
+    }
+
+    ~UIDataGrid(){ stopSort(); }
+
+    // The model must outlive the grid.
+    void setModel(GridModel* m){
+        stopSort();
+        model=m; perm.clear(); sortCol=-1; top=0; scrollX=0; current=-1;
+        widths.clear(); textMax.clear();
+        refresh();
+    }
+
+    // Call after the model's row/column count or contents changed
+    void refresh(){
+        int nc=cols();
+        if((int)widths.size()!=nc){ widths.resize(nc,defaultColW); textMax.resize(nc,0); rebuildColX(); }
+        if(!perm.empty()&&(int)perm.size()!=rows()) perm.clear();
+        if(current>=rows()) current=rows()-1;
+        clampScroll(); markDirty();
+    }
+
+    int rows() const { return model?std::max(0,model->rowCount()):0; }
+    int cols() const { return model?std::max(0,model->columnCount()):0; }
+    int rowHeight() const { return Font::active().lineHeight+4; }
+    int headerHeight() const { return Font::active().lineHeight+6; }
+    int visibleRows() const { return std::max(1,(rect.h-SB-2-headerHeight())/rowHeight()); }
+
+    // Model row shown at view row v (identity until a sort completes)
+    int modelRow(int v) const { return perm.empty()?v:perm[v]; }
+    int currentRow() const { return current; }
+    int sortColumn() const { return sortCol; }
+    bool sortAscending() const { return sortAsc; }
+    bool isSorting() const { return sorting.load(); }
+
+    int  columnWidth(int c) const { return widths[c]; }
+    void setColumnWidth(int c, int w){
+        if(c<0||c>=(int)widths.size()) return;
+        w=std::max(minColW,w);
+        if(widths[c]!=w){ widths[c]=w; rebuildColX(); clampScroll(); markDirty(); }
+    }
+
+    // Fit a column to the widest text seen so far (header + every cell drawn)
+    void autoSizeColumn(int c){
+        if(c<0||c>=(int)widths.size()) return;
+        model->header(c,scratch);
+        setColumnWidth(c,std::max(textMax[c],Draw::textWidth(scratch)+SORT_W)+CELL_PAD*2);
+    }
+
+    void setCurrent(int v){
+        current=std::max(-1,std::min(v,rows()-1));
+        if(current>=0){
+            int vis=visibleRows();
+            if(current<top) top=current; else if(current>=top+vis) top=current-vis+1;
+            syncBars();
+        }
+        markDirty();
+        UIEvent ve; ve.type=EventType::ValueChanged; ve.ivalue=current>=0?modelRow(current):-1; emit(ve);
+    }
+
+    void sortBy(int col, bool ascending){
+        if(!model||col<0||col>=cols()) return;
+        stopSort();
+        sortCol=col; sortAsc=ascending;
+        int n=rows();
+        GridModel* m=model;
+        cancel=false; sorting=true;
+        sorter=std::thread([this,m,col,ascending,n]{
+            std::vector<int> idx;
+            sortRows(m,col,ascending,n,idx,cancel);
+            if(!cancel){
+                std::lock_guard<std::mutex> lk(resMtx);
+                result.swap(idx); resultReady=true;
+            }
+            sorting=false;
+            if(!cancel) postInvalidate();
+        });
+        markDirty();
+    }
+
+    void onDraw() override {
+        adoptSort();
+        vbar->setRect(vbarRect()); hbar->setRect(hbarRect());
+        clampScroll();
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::EDIT_BG);
+        if(!model){ Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h); return; }
+        int nc=cols(), nr=rows();
+        int rh=rowHeight(), hh=headerHeight();
+        int vx=2, vy=2, vw=rect.w-SB-2, vh=rect.h-SB-2;      // view area (inside border)
+        int fw=nc>0?std::min(widths[0],vw-vx):0;              // frozen column width
+        int last=std::min(nr,top+visibleRows()+1);
+        uint32_t gridP=Pal::FACE.pack(surf);
+
+        // Visible scrolling columns: first one whose right edge passes scrollX
+        int c0=1, c1=1;
+        if(nc>1){
+            int base=colX[1]+scrollX;
+            c0=(int)(std::upper_bound(colX.begin()+1,colX.end(),base)-colX.begin())-1;
+            c0=std::max(1,std::min(c0,nc-1));
+            c1=c0;
+            while(c1<nc&&colX[c1]-colX[1]-scrollX<vw-vx-fw) c1++;
+        }
+
+        for(int v=top;v<last;v++){
+            int y=vy+hh+(v-top)*rh;
+            int mr=modelRow(v);
+            bool sel=v==current;
+            if(sel) Draw::fillRect(surf,vx,y,vw-vx,rh,focused?Pal::SEL_BG:Pal::FACE);
+            Color fg=sel&&focused?Pal::SEL_TXT:Pal::TEXT;
+            for(int c=c0;c<c1;c++)
+                drawCell(mr,c,vx+fw+colX[c]-colX[1]-scrollX,y,widths[c],rh,vx+fw,vw,fg);
+            if(nc>0){
+                if(!sel) Draw::fillRect(surf,vx,y,fw,rh,Pal::EDIT_BG);
+                drawCell(mr,0,vx,y,fw,rh,vx,vx+fw,fg);
+            }
+            for(int x=vx;x<vw;x+=2) Draw::setPixel(surf,x,y+rh-1,gridP);
+        }
+
+        // Header row (frozen)
+        Draw::fillRect(surf,vx,vy,vw-vx,hh,Pal::FACE);
+        for(int c=c0;c<c1;c++)
+            drawHeader(c,vx+fw+colX[c]-colX[1]-scrollX,vy,widths[c],hh,vx+fw,vw);
+        if(nc>0) drawHeader(0,vx,vy,fw,hh,vx,vx+fw);
+        Draw::drawVLine(surf,vx+fw-1,vy,std::min(vh,hh+(last-top)*rh),Pal::SHADOW);
+        // Corner between the scrollbars
+        Draw::fillRect(surf,rect.w-SB,rect.h-SB,SB,SB,Pal::FACE);
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseEnter){ setState(WidgetState::Hovered); return true; }
+        if(e.type==EventType::MouseLeave){ setState(WidgetState::Normal);  return true; }
+        int lx=e.mx-rect.x, ly=e.my-rect.y;
+        if(e.type==EventType::DblClick && ly<2+headerHeight()){
+            int b=boundaryAt(lx);
+            if(b>=0) autoSizeColumn(b);
+            return true;
+        }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            if(ly<2+headerHeight()){
+                int b=boundaryAt(lx);
+                if(b>=0){ resizing=b; dragX=e.mx; dragW=widths[b]; }
+                else {
+                    int c=columnAt(lx);
+                    if(c>=0) sortBy(c,c==sortCol?!sortAsc:true);
+                }
+            } else {
+                int v=top+(ly-2-headerHeight())/rowHeight();
+                if(v<rows()) setCurrent(v);
+            }
+            return true;
+        }
+        if(e.type==EventType::MouseMove && resizing>=0){
+            setColumnWidth(resizing,dragW+e.mx-dragX); return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ resizing=-1; return true; }
+        if(e.type==EventType::MouseWheel){
+            int t=std::max(0,std::min(maxTop(),top-e.wheel*3));
+            if(t!=top){ top=t; syncBars(); markDirty(); }
+            return true;
+        }
+        if(e.type==EventType::KeyDown && focused){
+            int n=rows(), v=visibleRows();
+            if(!n) return true;
+            int c=current<0?0:current;
+            switch(e.key){
+                case SDLK_UP:       setCurrent(std::max(0,c-1)); break;
+                case SDLK_DOWN:     setCurrent(std::min(n-1,c+1)); break;
+                case SDLK_PAGEUP:   setCurrent(std::max(0,c-v)); break;
+                case SDLK_PAGEDOWN: setCurrent(std::min(n-1,c+v)); break;
+                case SDLK_HOME:     setCurrent(0); break;
+                case SDLK_END:      setCurrent(n-1); break;
+                case SDLK_LEFT:     scrollX=std::max(0,scrollX-defaultColW); syncBars(); markDirty(); break;
+                case SDLK_RIGHT:    scrollX=std::min(maxScrollX(),scrollX+defaultColW); syncBars(); markDirty(); break;
+                default: return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    static const int CELL_PAD=4, SORT_W=12;
+
+    GridModel*          model=nullptr;
+    std::vector<int>    widths;
+    std::vector<int>    colX;       // prefix sums of widths: colX[c] = left edge of column c
+    std::vector<int>    textMax;    // widest cell text drawn so far, per column
+    std::vector<int>    perm;       // view row -> model row (empty = identity)
+    int                 top=0, scrollX=0, current=-1;
+    int                 sortCol=-1;
+    bool                sortAsc=true;
+    int                 resizing=-1, dragX=0, dragW=0;
+    std::string         scratch;
+
+    // Background sort
+    std::thread         sorter;
+    std::atomic<bool>   cancel{false}, sorting{false};
+    std::mutex          resMtx;
+    std::vector<int>    result;
+    bool                resultReady=false;
+
+    Rect vbarRect() const { return Rect(rect.w-SB,0,SB,rect.h-SB); }
+    Rect hbarRect() const { return Rect(0,rect.h-SB,rect.w-SB,SB); }
+
+    int maxTop() const { return std::max(0,rows()-visibleRows()); }
+    int maxScrollX() const {
+        if(widths.size()<2) return 0;
+        int scrollW=rect.w-SB-4-widths[0];
+        return std::max(0,colX.back()-colX[1]-scrollW);
+    }
+
+    void rebuildColX(){
+        colX.assign(widths.size()+1,0);
+        for(size_t i=0;i<widths.size();i++) colX[i+1]=colX[i]+widths[i];
+    }
+
+    void clampScroll(){
+        top=std::max(0,std::min(top,maxTop()));
+        scrollX=std::max(0,std::min(scrollX,maxScrollX()));
+        syncBars();
+    }
+
+    void syncBars(){
+        int n=rows(), v=visibleRows(), m=maxTop();
+        vbar->thumbRatio=n>v?(float)v/n:1.f;
+        vbar->setValue(m?(float)top/m:0.f);
+        int mx=maxScrollX(), cw=widths.size()>1?colX.back()-colX[1]:0;
+        hbar->thumbRatio=cw>0&&mx>0?(float)(cw-mx)/cw:1.f;
+        hbar->setValue(mx?(float)scrollX/mx:0.f);
+    }
+
+    // Draw one cell clipped to [clipL,clipR) horizontally
+    void drawCell(int row, int c, int x, int y, int w, int h, int clipL, int clipR, Color fg){
+        int l=std::max(x,clipL), r=std::min(x+w,clipR);
+        if(r<=l) return;
+        model->cellText(row,c,scratch);
+        int tw=Draw::textWidth(scratch);
+        if(tw>textMax[c]) textMax[c]=tw;
+        SDL_Rect clip={l,y,r-l,h};
+        SDL_SetClipRect(surf,&clip);
+        Draw::drawText(surf,x+CELL_PAD,y+(h-Draw::textHeight())/2,scratch,fg);
+        SDL_SetClipRect(surf,nullptr);
+        Draw::drawVLine(surf,x+w-1,y,h,Pal::FACE);
+    }
+
+    void drawHeader(int c, int x, int y, int w, int h, int clipL, int clipR){
+        int l=std::max(x,clipL), r=std::min(x+w,clipR);
+        if(r<=l) return;
+        SDL_Rect clip={l,y,r-l,h};
+        SDL_SetClipRect(surf,&clip);
+        Draw::fillRect(surf,x,y,w,h,Pal::FACE);
+        Draw::drawBevel(surf,x,y,w,h,true);
+        model->header(c,scratch);
+        Draw::drawText(surf,x+CELL_PAD,y+(h-Draw::textHeight())/2,scratch,Pal::TEXT);
+        if(c==sortCol){
+            int ax=x+w-SORT_W, ay=y+h/2-2;
+            if(sortAsc) Draw::drawArrowUp(surf,ax,ay,4,sorting?Pal::SHADOW:Pal::TEXT);
+            else        Draw::drawArrowDown(surf,ax,ay,4,sorting?Pal::SHADOW:Pal::TEXT);
+        }
+        SDL_SetClipRect(surf,nullptr);
+    }
+
+    // Column whose right edge is within 3px of local x (header hit-test)
+    int boundaryAt(int lx) const {
+        int nc=(int)widths.size();
+        if(!nc) return -1;
+        int fw=widths[0];
+        if(std::abs(lx-(2+fw))<=3) return 0;
+        for(int c=1;c<nc;c++){
+            int edge=2+fw+colX[c+1]-colX[1]-scrollX;
+            if(edge>rect.w-SB) break;
+            if(std::abs(lx-edge)<=3) return c;
+        }
+        return -1;
+    }
+
+    int columnAt(int lx) const {
+        int nc=(int)widths.size();
+        if(!nc||lx<2) return -1;
+        int fw=widths[0];
+        if(lx<2+fw) return 0;
+        int cx=lx-2-fw+scrollX+colX[1];
+        int c=(int)(std::upper_bound(colX.begin(),colX.end(),cx)-colX.begin())-1;
+        return c>=1&&c<nc?c:-1;
+    }
+
+    void stopSort(){
+        cancel=true;
+        if(sorter.joinable()) sorter.join();
+        cancel=false;
+    }
+
+    void adoptSort(){
+        std::lock_guard<std::mutex> lk(resMtx);
+        if(!resultReady) return;
+        resultReady=false;
+        if((int)result.size()!=rows()){ result.clear(); return; }
+        // Keep the same model row selected across the reorder
+        int keep=current>=0?modelRow(current):-1;
+        perm.swap(result); result.clear();
+        if(keep>=0){
+            current=(int)(std::find(perm.begin(),perm.end(),keep)-perm.begin());
+        }
+        syncBars();
+    }
+
+    // Builds the view->model permutation for one column. Keys are fetched
+    // once, then chunks are sorted on separate threads and merged pairwise.
+    static void sortRows(GridModel* m, int col, bool asc, int n, std::vector<int>& idx,
+                         const std::atomic<bool>& cancel){
+        std::vector<std::string> keys(n);
+        std::vector<double>      nums(n);
+        bool numeric=true;
+        for(int r=0;r<n;r++){
+            if((r&4095)==0&&cancel) return;
+            m->cellText(r,col,keys[r]);
+            if(!numeric) continue;
+            const char* s=keys[r].c_str(); char* end=nullptr;
+            if(!*s){ nums[r]=-HUGE_VAL; continue; }
+            nums[r]=std::strtod(s,&end);
+            // "nan" parses, but would break the strict weak ordering
+            if(end==s||*end||nums[r]!=nums[r]) numeric=false;
+        }
+        idx.resize(n);
+        for(int i=0;i<n;i++) idx[i]=i;
+        auto less=[&](int a, int b)->bool{
+            if(numeric){ if(nums[a]!=nums[b]) return asc?nums[a]<nums[b]:nums[a]>nums[b]; }
+            else { int k=keys[a].compare(keys[b]); if(k) return asc?k<0:k>0; }
+            return a<b;
+        };
+        unsigned hw=std::max(1u,std::thread::hardware_concurrency());
+        int parts=n<65536?1:(int)std::min(hw,16u);
+        std::vector<int> bound(parts+1);
+        for(int i=0;i<=parts;i++) bound[i]=(int)((long long)n*i/parts);
+        auto run=[&](std::vector<std::thread>& ts){ for(auto& t: ts) t.join(); ts.clear(); };
+        std::vector<std::thread> ts;
+        for(int i=1;i<parts;i++)
+            ts.push_back(std::thread([&,i]{ std::sort(idx.begin()+bound[i],idx.begin()+bound[i+1],less); }));
+        std::sort(idx.begin()+bound[0],idx.begin()+bound[1],less);
+        run(ts);
+        for(int w=1;w<parts&&!cancel;w*=2){
+            for(int i=0;i+w<parts;i+=2*w){
+                int a=bound[i], b=bound[i+w], c=bound[std::min(i+2*w,parts)];
+                ts.push_back(std::thread([&,a,b,c]{ std::inplace_merge(idx.begin()+a,idx.begin()+b,idx.begin()+c,less); }));
+            }
+            run(ts);
+        }
+    }
+};
+
+// ─── UIScrollView (scrolling container) ─────────────────────────────────────
+// Children are added to a UIScrollContent viewport and keep rects relative to
+// the top-left of the virtual content area. Scrolling never moves or frees
+// child surfaces: the viewport shifts its own pixels and only re-blits the
+// strip that scrolled into view. Children outside the viewport aren't drawn.
+class UIScrollContent : public UIComponent {
+public:
+    int scrollX=0, scrollY=0;
+    int contentW=0, contentH=0;
+
+    UIScrollContent(const std::string& id_, Rect r) : UIComponent(id_,r) { bgColor=Pal::FACE; }
+
+    bool mapToChildSpace(int& x, int& y) const override {
+        bool inside=rect.contains(x,y);
+        x=x-rect.x+scrollX; y=y-rect.y+scrollY;
+        return inside;
+    }
+
+    void mapFromChildSpace(int& x, int& y) const override { x+=rect.x-scrollX; y+=rect.y-scrollY; }
+
+    void onDraw() override { Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor); }
+
+    void render() override {
+        ensureSurf();
+        if(!dirty) return;
+        onDraw();
+        for(auto& ch: children) blitChild(ch.get());
+        dirty=false;
+    }
+
+    void scrollTo(int x, int y){
+        x=std::max(0,std::min(x,std::max(0,contentW-rect.w)));
+        y=std::max(0,std::min(y,std::max(0,contentH-rect.h)));
+        int dx=x-scrollX, dy=y-scrollY;
+        if(!dx&&!dy) return;
+        scrollX=x; scrollY=y;
+        if(dirty||!surf||surf->w!=rect.w||surf->h!=rect.h||std::abs(dx)>=rect.w||std::abs(dy)>=rect.h){
+            markDirty(); return;
+        }
+        shiftPixels(-dx,-dy);
+        // Exposed strips along the edge we scrolled towards
+        if(dy>0) repaintRegion(Rect(0,rect.h-dy,rect.w,dy));
+        if(dy<0) repaintRegion(Rect(0,0,rect.w,-dy));
+        if(dx>0) repaintRegion(Rect(rect.w-dx,0,dx,rect.h));
+        if(dx<0) repaintRegion(Rect(0,0,-dx,rect.h));
+        // Parents must re-composite, but this surface is already up to date
+        if(parent) parent->markDirty();
+    }
+
+    // Re-blit the background and children over a viewport-local rect
+    void repaintRegion(Rect r){
+        SDL_Rect clip=r.toSDL();
+        SDL_SetClipRect(surf,&clip);
+        onDraw();
+        for(auto& ch: children) blitChild(ch.get(),&r);
+        SDL_SetClipRect(surf,nullptr);
+    }
+
+private:
+    void blitChild(UIComponent* ch, const Rect* only=nullptr){
+        if(!ch->visible) return;
+        int x=ch->rect.x-scrollX, y=ch->rect.y-scrollY;
+        const Rect& v=only?*only:Rect(0,0,rect.w,rect.h);
+        if(x>=v.x+v.w||y>=v.y+v.h||x+ch->rect.w<=v.x||y+ch->rect.h<=v.y) return;
+        ch->render();
+        SDL_Rect dst={x,y,ch->rect.w,ch->rect.h};
+        SDL_BlitSurface(ch->surf,nullptr,surf,&dst);
+    }
+
+    void shiftPixels(int dx, int dy){
+        int w=rect.w, h=rect.h, pitch=surf->pitch;
+        uint8_t* px=(uint8_t*)surf->pixels;
+        size_t rowBytes=(size_t)(w-std::abs(dx))*4;
+        if(dy<=0){
+            for(int y=0;y<h+dy;y++){
+                uint8_t* dst=px+y*pitch, *src=px+(y-dy)*pitch;
+                std::memmove(dst+std::max(dx,0)*4,src+std::max(-dx,0)*4,rowBytes);
+            }
+        } else {
+            for(int y=h-1;y>=dy;y--){
+                uint8_t* dst=px+y*pitch, *src=px+(y-dy)*pitch;
+                std::memmove(dst+std::max(dx,0)*4,src+std::max(-dx,0)*4,rowBytes);
+            }
+        }
+    }
+};
+
+class UIScrollView : public UIComponent {
+public:
+    UIScrollContent* content=nullptr;
+    UIScrollBar*     vbar=nullptr;
+    UIScrollBar*     hbar=nullptr;
+    int              wheelStep=0;    // pixels per wheel notch (0 = 3 text lines)
+
+    static const int SB=16;
+
+    UIScrollView(const std::string& id_, Rect r, UIContext& ctx, int contentW=0, int contentH=0)
+        : UIComponent(id_,r) {
+        content=static_cast<UIScrollContent*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollContent(id_+"_content",contentRect())),ctx));
+        vbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_vsb",vbarRect())),ctx));
+        hbar=static_cast<UIScrollBar*>(addChild(
+            std::unique_ptr<UIComponent>(new UIScrollBar(id_+"_hsb",hbarRect(),true)),ctx));
+        vbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            content->scrollTo(content->scrollX,(int)(e.fvalue*maxY()+0.5f));
+        });
+        hbar->on(EventType::Scroll,[this](UIComponent*,const UIEvent& e){
+            content->scrollTo((int)(e.fvalue*maxX()+0.5f),content->scrollY);
+        });
+        setContentSize(contentW,contentH);
+    }
+
+    // Child rect is relative to the content origin; grows the content to fit
+    UIComponent* addContent(std::unique_ptr<UIComponent> c, UIContext& ctx){
+        Rect cr=c->rect;
+        auto* p=content->addChild(std::move(c),ctx);
+        setContentSize(std::max(content->contentW,cr.x+cr.w),std::max(content->contentH,cr.y+cr.h));
+        return p;
+    }
+
+    void setContentSize(int w, int h){
+        content->contentW=w; content->contentH=h;
+        content->scrollTo(content->scrollX,content->scrollY);
+        syncBars();
+    }
+
+    void scrollTo(int x, int y){ content->scrollTo(x,y); syncBars(); }
+    int  scrollX() const { return content->scrollX; }
+    int  scrollY() const { return content->scrollY; }
+
+    // Scroll the minimum needed to bring a content-space rect into view
+    void ensureVisible(Rect r){
+        int x=content->scrollX, y=content->scrollY;
+        int vw=content->rect.w, vh=content->rect.h;
+        if(r.x<x) x=r.x; else if(r.x+r.w>x+vw) x=r.x+r.w-vw;
+        if(r.y<y) y=r.y; else if(r.y+r.h>y+vh) y=r.y+r.h-vh;
+        scrollTo(x,y);
+    }
+
+    void onDraw() override {
+        // Keep parts attached if the view was moved/resized
+        content->setRect(contentRect()); vbar->setRect(vbarRect()); hbar->setRect(hbarRect());
+        Draw::fillRect(surf,rect.w-SB-2,rect.h-SB-2,SB,SB,Pal::FACE);
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+    }
+
+    bool onEvent(const UIEvent& e, UIContext&) override {
+        if(!enabled) return false;
+        if(e.type==EventType::MouseWheel){
+            int step=wheelStep>0?wheelStep:Font::active().lineHeight*3;
+            if(e.mod&KMOD_SHIFT) scrollTo(content->scrollX-e.wheel*step,content->scrollY);
+            else                 scrollTo(content->scrollX,content->scrollY-e.wheel*step);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    Rect contentRect() const { return Rect(2,2,rect.w-4-SB,rect.h-4-SB); }
+    Rect vbarRect() const { return Rect(rect.w-2-SB,2,SB,rect.h-4-SB); }
+    Rect hbarRect() const { return Rect(2,rect.h-2-SB,rect.w-4-SB,SB); }
+
+    int maxX() const { return std::max(0,content->contentW-content->rect.w); }
+    int maxY() const { return std::max(0,content->contentH-content->rect.h); }
+
+    void syncBars(){
+        int cw=std::max(1,content->contentW), chh=std::max(1,content->contentH);
+        vbar->thumbRatio=std::min(1.f,(float)content->rect.h/chh);
+        hbar->thumbRatio=std::min(1.f,(float)content->rect.w/cw);
+        vbar->setValue(maxY()?(float)content->scrollY/maxY():0.f);
+        hbar->setValue(maxX()?(float)content->scrollX/maxX():0.f);
+    }
+};
+
+// ─── UIPlot (streaming series, min/max decimation) ───────────────────────────
+// Each PlotSeries is a fixed-size ring of samples plus a min/max pyramid
+// (blocks of 16, 256, 4096, ... samples) that the producer keeps up to date
+// as it appends. A pixel column's envelope is then read from at most a few
+// dozen pyramid entries, so a redraw costs O(plot width) whatever the span.
+// append() is for a single producer thread per series and takes no locks;
+// it only posts a redraw to the UI once per frame.
+class PlotSeries {
+public:
+    std::string name;
+    Color       color;
+
+    PlotSeries(const std::string& n, Color c, size_t capacity) : name(n), color(c) {
+        capacity=std::max<size_t>(capacity,64);
+        // Levels up to a block size of ~cap/4; cap is rounded to a multiple of the largest
+        size_t top=1;
+        while(top*16<=capacity/4&&levelCount<MAX_LEVELS-1){ top*=16; levelCount++; }
+        cap=(capacity+top-1)/top*top;
+        data.reset(new std::atomic<float>[cap]);
+        size_t b=1;
+        for(int k=1;k<=levelCount;k++){
+            b*=16; blockSize[k]=b; slots[k]=cap/b;
+            levels[k].reset(new MinMax[slots[k]]);
+        }
+    }
+
+    // Producer side (one thread per series)
+    void append(float v){
+        uint64_t i=head.load(std::memory_order_relaxed);
+        data[(size_t)(i%cap)].store(v,std::memory_order_relaxed);
+        for(int k=1;k<=levelCount;k++){
+            MinMax& m=levels[k][(size_t)((i/blockSize[k])%slots[k])];
+            if(i%blockSize[k]==0){ m.mn.store(v,std::memory_order_relaxed); m.mx.store(v,std::memory_order_relaxed); }
+            else {
+                if(v<m.mn.load(std::memory_order_relaxed)) m.mn.store(v,std::memory_order_relaxed);
+                if(v>m.mx.load(std::memory_order_relaxed)) m.mx.store(v,std::memory_order_relaxed);
+            }
+        }
+        head.store(i+1,std::memory_order_release);
+        wake();
+    }
+    void append(const float* v, size_t n){ for(size_t i=0;i<n;i++) append(v[i]); }
+
+    // Reader side
+    uint64_t size() const { return head.load(std::memory_order_acquire); }
+    size_t   capacity() const { return (size_t)cap; }
+    uint64_t oldest() const { uint64_t h=size(); return h>cap?h-cap:0; }
+    float    at(uint64_t i) const { return data[(size_t)(i%cap)].load(std::memory_order_relaxed); }
+
+    // Min/max of samples [a,b); false if the range holds no stored samples
+    bool range(uint64_t a, uint64_t b, float& mn, float& mx) const {
+        uint64_t h=size(), lo=h>cap?h-cap+cap/8:0;   // keep clear of the slots being recycled
+        a=std::max(a,lo); b=std::min(b,h);
+        if(a>=b) return false;
+        mn=HUGE_VALF; mx=-HUGE_VALF;
+        uint64_t i=a;
+        while(i<b){
+            int k=0;
+            while(k<levelCount&&i%blockSize[k+1]==0&&i+blockSize[k+1]<=b) k++;
+            if(k==0){
+                float v=at(i++);
+                mn=std::min(mn,v); mx=std::max(mx,v);
+            } else {
+                const MinMax& m=levels[k][(size_t)((i/blockSize[k])%slots[k])];
+                mn=std::min(mn,m.mn.load(std::memory_order_relaxed));
+                mx=std::max(mx,m.mx.load(std::memory_order_relaxed));
+                i+=blockSize[k];
+            }
+        }
+        return true;
+    }
+
+private:
+    friend class UIPlot;
+    struct MinMax { std::atomic<float> mn{0.f}, mx{0.f}; };
+    static const int MAX_LEVELS=8;
+
+    uint64_t                              cap=0;
+    std::unique_ptr<std::atomic<float>[]> data;
+    std::unique_ptr<MinMax[]>             levels[MAX_LEVELS];
+    uint64_t                              blockSize[MAX_LEVELS]={1};
+    uint64_t                              slots[MAX_LEVELS]={0};
+    int                                   levelCount=0;
+    std::atomic<uint64_t>                 head{0};
+
+    UIComponent*                          owner=nullptr;
+    std::atomic<bool>                     wakePending{false};
+
+    void wake(){
+        // A dropped post would never be drawn, so it must not keep us latched
+        if(owner&&!wakePending.exchange(true,std::memory_order_acq_rel))
+            if(!owner->postInvalidate()) wakePending.store(false,std::memory_order_release);
+    }
+};
+
+enum class PlotMode { Envelope, Line };
+
+class UIPlot : public UIComponent {
+public:
+    PlotMode mode=PlotMode::Envelope;
+    bool     follow=true;       // keep the newest sample at the right edge
+    bool     autoY=true;
+    float    yMin=0.f, yMax=1.f;
+    double   span=1000.0;       // samples across the plot width
+    double   viewEnd=0.0;       // sample index at the right edge (when !follow)
+    double   xScale=1.0, xOrigin=0.0;   // axis label = index*xScale + xOrigin
+    std::string title;
+
+    UIPlot(const std::string& id_, Rect r) : UIComponent(id_,r) { bgColor=Pal::EDIT_BG; }
+
+    PlotSeries* addSeries(const std::string& name, Color c, size_t capacity=1<<20){
+        series.push_back(std::unique_ptr<PlotSeries>(new PlotSeries(name,c,capacity)));
+        series.back()->owner=this;
+        markDirty();
+        return series.back().get();
+    }
+    PlotSeries* getSeries(size_t i){ return i<series.size()?series[i].get():nullptr; }
+    size_t      seriesCount() const { return series.size(); }
+
+    void setYRange(float mn, float mx){ autoY=false; yMin=mn; yMax=mx; markDirty(); }
+    void resetView(){ follow=true; autoY=true; markDirty(); }
+
+    void onDraw() override {
+        for(auto& s: series) s->wakePending.store(false,std::memory_order_release);
+        const Font& f=Font::active();
+        int lh=f.lineHeight;
+        Rect pa=plotArea();
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::FACE);
+        Draw::fillRect(surf,pa.x,pa.y,pa.w,pa.h,bgColor);
+        int W=std::max(1,pa.w);
+
+        // Visible sample window
+        uint64_t newest=0;
+        for(auto& s: series) newest=std::max(newest,s->size());
+        if(follow) viewEnd=(double)newest;
+        double x0=viewEnd-span;
+
+        // Per-column envelopes
+        float lo=HUGE_VALF, hi=-HUGE_VALF;
+        cols.resize(series.size());
+        for(size_t si=0;si<series.size();si++){
+            Columns& c=cols[si];
+            c.mn.resize(W); c.mx.resize(W); c.has.assign(W,0);
+            for(int px=0;px<W;px++){
+                double a=x0+span*px/W, b=x0+span*(px+1)/W;
+                uint64_t ia=(uint64_t)std::max(0.0,std::floor(a)), ib=(uint64_t)std::max(0.0,std::ceil(b));
+                if(ib<=ia) ib=ia+1;
+                float mn,mx;
+                if(series[si]->range(ia,ib,mn,mx)){
+                    c.mn[px]=mn; c.mx[px]=mx; c.has[px]=1;
+                    lo=std::min(lo,mn); hi=std::max(hi,mx);
+                }
+            }
+        }
+        if(autoY&&lo<=hi){
+            float pad=(hi-lo)*0.05f;
+            if(pad<=0.f) pad=std::max(1e-6f,std::fabs(hi)*0.05f+1e-6f);
+            yMin=lo-pad; yMax=hi+pad;
+        }
+        float ys=(yMax>yMin)?(float)(pa.h-1)/(yMax-yMin):1.f;
+        auto toY=[&](float v)->float{
+            return std::max((float)pa.y,std::min((float)(pa.y+pa.h-1),pa.y+pa.h-1-(v-yMin)*ys));
+        };
+
+        // Grid and axis labels
+        uint32_t gridP=Pal::FACE.pack(surf);
+        char buf[32];
+        double yStep=niceStep(yMax-yMin,std::max(2,pa.h/(lh*3)));
+        for(double v=std::ceil(yMin/yStep)*yStep;v<=yMax;v+=yStep){
+            int y=(int)toY((float)v);
+            for(int x=pa.x;x<pa.x+pa.w;x+=3) Draw::setPixel(surf,x,y,gridP);
+            snprintf(buf,sizeof(buf),"%g",std::fabs(v)<yStep*1e-6?0.0:v);
+            Draw::drawText(surf,pa.x-4-Draw::textWidth(buf),y-lh/2,buf,Pal::TEXT);
+        }
+        double xs0=x0*xScale+xOrigin, xs1=viewEnd*xScale+xOrigin;
+        double xStep=niceStep(xs1-xs0,std::max(2,pa.w/(f.advance('0')*10)));
+        for(double v=std::ceil(xs0/xStep)*xStep;v<=xs1;v+=xStep){
+            int x=pa.x+(int)((v-xs0)/(xs1-xs0)*pa.w);
+            for(int y=pa.y;y<pa.y+pa.h;y+=3) Draw::setPixel(surf,x,y,gridP);
+            snprintf(buf,sizeof(buf),"%g",std::fabs(v)<xStep*1e-6?0.0:v);
+            int tw=Draw::textWidth(buf);
+            Draw::drawText(surf,std::max(0,std::min(rect.w-tw,x-tw/2)),pa.y+pa.h+3,buf,Pal::TEXT);
+        }
+
+        // Series
+        SDL_Rect clip=pa.toSDL();
+        SDL_SetClipRect(surf,&clip);
+        for(size_t si=0;si<series.size();si++){
+            Columns& c=cols[si];
+            Color col=series[si]->color;
+            if(mode==PlotMode::Envelope){
+                int prevLo=-1, prevHi=-1;
+                for(int px=0;px<W;px++){
+                    if(!c.has[px]){ prevLo=-1; continue; }
+                    int yTop=(int)toY(c.mx[px]), yBot=(int)toY(c.mn[px]);
+                    // bridge to the previous column so steep edges stay connected
+                    if(prevLo>=0){ yTop=std::min(yTop,prevHi); yBot=std::max(yBot,prevLo); }
+                    Draw::drawVLine(surf,pa.x+px,yTop,yBot-yTop+1,col);
+                    prevLo=(int)toY(c.mn[px]); prevHi=(int)toY(c.mx[px]);
+                }
+            } else {
+                lttb(c,W);
+                path.clear();
+                bool pen=false;
+                for(int px=0;px<W;px++){
+                    if(!c.has[px]){ pen=false; continue; }
+                    float y=toY(c.pick[px]);
+                    if(pen) path.lineTo(pa.x+px+0.5f,y); else { path.moveTo(pa.x+px+0.5f,y); pen=true; }
+                }
+                Draw::strokePath(surf,path,col,1.5f,true);
+            }
+        }
+        SDL_SetClipRect(surf,nullptr);
+
+        // Frame, legend, title
+        Draw::drawSunkenBorder(surf,pa.x-2,pa.y-2,pa.w+4,pa.h+4);
+        int ly=pa.y+2;
+        for(auto& s: series){
+            Draw::fillRect(surf,pa.x+4,ly+lh/2-3,8,6,s->color);
+            Draw::drawText(surf,pa.x+16,ly,s->name,Pal::TEXT);
+            ly+=lh+1;
+        }
+        if(!title.empty()) Draw::drawTextCentered(surf,0,0,rect.w,lh+4,title,Pal::TEXT);
+    }
+
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        Rect pa=plotArea();
+        int lx=e.mx-rect.x;
+        if(e.type==EventType::MouseWheel){
+            // Zoom about the sample under the cursor (the right edge while following)
+            double fx=follow?1.0:std::max(0.0,std::min(1.0,(double)(lx-pa.x)/std::max(1,pa.w)));
+            double anchor=viewEnd-span*(1.0-fx);
+            span=std::max(8.0,span*(e.wheel>0?0.8:1.25));
+            viewEnd=anchor+span*(1.0-fx);
+            markDirty(); return true;
+        }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            dragging=true; dragX=e.mx; dragEnd=viewEnd; return true;
+        }
+        if(e.type==EventType::MouseMove && dragging){
+            double d=(double)(e.mx-dragX)*span/std::max(1,pa.w);
+            if(d!=0.0) follow=false;
+            viewEnd=dragEnd-d;
+            uint64_t newest=0;
+            for(auto& s: series) newest=std::max(newest,s->size());
+            if(viewEnd>=(double)newest){ viewEnd=(double)newest; follow=true; }
+            markDirty(); return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
+        if(e.type==EventType::DblClick){ resetView(); return true; }
+        return false;
+    }
+
+private:
+    struct Columns { std::vector<float> mn, mx, pick; std::vector<uint8_t> has; };
+
+    std::vector<std::unique_ptr<PlotSeries>> series;
+    std::vector<Columns>                     cols;     // per-series scratch, reused every frame
+    Draw::Path                               path;
+    bool   dragging=false;
+    int    dragX=0;
+    double dragEnd=0.0;
+
+    Rect plotArea() const {
+        int lh=Font::active().lineHeight;
+        int left=Font::active().advance('0')*7+8;
+        int topM=title.empty()?6:lh+6;
+        return Rect(left,topM,std::max(1,rect.w-left-8),std::max(1,rect.h-topM-lh-8));
+    }
+
+    static double niceStep(double range, int ticks){
+        if(!(range>0)) return 1.0;
+        double raw=range/ticks, p=std::pow(10.0,std::floor(std::log10(raw))), m=raw/p;
+        return (m<1.5?1:m<3.5?2:m<7.5?5:10)*p;
+    }
+
+    // Largest-Triangle-Three-Buckets with one bucket per column. Candidates
+    // are the column's min and max; the next bucket is represented by the
+    // midpoint of its envelope.
+    static void lttb(Columns& c, int W){
+        c.pick.resize(W);
+        int prev=-1; float prevY=0.f;
+        for(int px=0;px<W;px++){
+            if(!c.has[px]) { prev=-1; continue; }
+            if(prev<0){ c.pick[px]=(c.mn[px]+c.mx[px])*0.5f; prev=px; prevY=c.pick[px]; continue; }
+            int nx=px+1;
+            while(nx<W&&!c.has[nx]) nx++;
+            float ny=nx<W?(c.mn[nx]+c.mx[nx])*0.5f:(c.mn[px]+c.mx[px])*0.5f;
+            if(nx>=W) nx=px+1;
+            auto area=[&](float y){ return std::fabs((prev-nx)*(y-prevY)-(prev-px)*(ny-prevY)); };
+            c.pick[px]=area(c.mx[px])>=area(c.mn[px])?c.mx[px]:c.mn[px];
+            prev=px; prevY=c.pick[px];
+        }
+    }
+};
+
+// ─── UIImageView ──────────────────────────────────────────────────────────────
+// Zoomable image viewer. Decoding and the mip pyramid are built on a worker
+// thread; the view draws the 256x256 tiles of the level closest to the
+// current zoom and keeps recently used tiles in an LRU cache bounded in bytes.
+enum class RawFormat  { ARGB8888, RGB24, Gray8 };
+enum class ImageState { Empty, Loading, Ready, Failed };
+
+class UIImageView : public UIComponent {
+public:
+    static const int TILE=256;
+    size_t cacheBudget=64u<<20;     // bytes of tile surfaces kept between frames
+    double zoom=1.0;                // screen pixels per image pixel
+    double panX=0.0, panY=0.0;      // image coordinate at the top-left corner
+    bool   fitOnLoad=true;
+
+    UIImageView(const std::string& id_, Rect r) : UIComponent(id_,r) { bgColor=Pal::EDIT_BG; }
+    ~UIImageView(){ stopWorker(); resetImage(); }
+
+    // Cached tiles go too; the pyramid stays, so they are re-cut on demand
+    void releaseSurfaces() override {
+        for(auto& t: tiles) SDL_FreeSurface(t.second.s);
+        tiles.clear(); lru.clear(); bytes=0;
+        UIComponent::releaseSurfaces();
+    }
+
+    void loadBMP(const std::string& path){
+        startLoad([this,path]()->bool{
+            SDL_Surface* raw=SDL_LoadBMP(path.c_str());
+            if(!raw) return false;
+            SDL_Surface* s=SDL_ConvertSurfaceFormat(raw,SDL_PIXELFORMAT_ARGB8888,0);
+            SDL_FreeSurface(raw);
+            if(!s) return false;
+            src=s; srcW=s->w; srcH=s->h;
+            return true;
+        });
+    }
+
+    // Uncompressed pixels read straight from a memory-mapped file. `offset`
+    // skips a header; `stride` defaults to tightly packed rows. RGB24 is R,G,B.
+    void loadRaw(const std::string& path, int w, int h, RawFormat fmt, size_t offset=0, size_t stride=0){
+        startLoad([this,path,w,h,fmt,offset,stride]()->bool{
+            size_t bpp=fmt==RawFormat::ARGB8888?4:fmt==RawFormat::RGB24?3:1;
+            size_t st=stride?stride:(size_t)w*bpp;
+            if(w<=0||h<=0||st<(size_t)w*bpp||!map.open(path)) return false;
+            if(map.size()<offset||map.size()-offset<st*(size_t)(h-1)+(size_t)w*bpp){ map.close(); return false; }
+            rawFmt=fmt; rawOff=offset; rawStride=st; srcW=w; srcH=h;
+            return true;
+        });
+    }
+
+    void clear(){ stopWorker(); resetImage(); markDirty(); }
+
+    ImageState state() const { return (ImageState)status.load(); }
+    int imageWidth()  const { return ready.load(std::memory_order_acquire)?srcW:0; }
+    int imageHeight() const { return ready.load(std::memory_order_acquire)?srcH:0; }
+
+    void fitToView(){ fit(); markDirty(); }
+    void setZoom(double z){ zoomAbout(z,rect.w/2,rect.h/2); }
+
+    void onDraw() override {
+        adoptTiles();
+        Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor);
+        int nready=ready.load(std::memory_order_acquire);
+        if(!nready){
+            ImageState s=state();
+            if(s!=ImageState::Empty)
+                Draw::drawTextCentered(surf,0,0,rect.w,rect.h,s==ImageState::Failed?"Cannot load image":"Loading...",Pal::DISABLED_TXT);
+            Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+            return;
+        }
+        if(fitPending){ fitPending=false; fit(); }
+        frame++;
+
+        // Finest level whose pixels are still at least one screen pixel
+        int want=0;
+        while(want+1<(int)levels.size()&&zoom*(double)(1<<(want+1))<=1.0) want++;
+        int L=std::min(want,nready-1);
+        const Level& lv=levels[L];
+        double scale=zoom*(double)(1<<L);
+        double lx0=panX/(1<<L), ly0=panY/(1<<L);
+        int ntx=(lv.w+TILE-1)/TILE, nty=(lv.h+TILE-1)/TILE;
+        int tx0=std::max(0,(int)std::floor(lx0/TILE)), ty0=std::max(0,(int)std::floor(ly0/TILE));
+        int tx1=std::min(ntx-1,(int)std::floor((lx0+rect.w/scale)/TILE));
+        int ty1=std::min(nty-1,(int)std::floor((ly0+rect.h/scale)/TILE));
+
+        misses.clear();
+        // While the pyramid is still building a zoomed-out view would need
+        // too many full-resolution tiles; wait for the coarser level instead.
+        if(L<want&&(long)(tx1-tx0+1)*(ty1-ty0+1)>64){
+            Draw::drawTextCentered(surf,0,0,rect.w,rect.h,"Building preview...",Pal::DISABLED_TXT);
+        } else {
+            SDL_Rect clip={2,2,std::max(0,rect.w-4),std::max(0,rect.h-4)};
+            SDL_SetClipRect(surf,&clip);
+            for(int ty=ty0;ty<=ty1;ty++){
+                for(int tx=tx0;tx<=tx1;tx++){
+                    int px=tx*TILE, py=ty*TILE;
+                    int pw=lv.w-px<TILE?lv.w-px:TILE, ph=lv.h-py<TILE?lv.h-py:TILE;
+                    int x0=(int)std::floor((px-lx0)*scale), x1=(int)std::floor((px+pw-lx0)*scale);
+                    int y0=(int)std::floor((py-ly0)*scale), y1=(int)std::floor((py+ph-ly0)*scale);
+                    SDL_Rect dst={x0,y0,x1-x0,y1-y0};
+                    if(dst.w<=0||dst.h<=0) continue;
+                    uint64_t k=tileKey(L,tx,ty);
+                    if(SDL_Surface* t=lookup(k)){ blit(t,nullptr,dst); continue; }
+                    misses.push_back(k);
+                    // Stand in with an upscaled part of a cached coarser tile
+                    for(int up=1;up<=3&&L+up<nready;up++){
+                        SDL_Surface* c=lookup(tileKey(L+up,tx>>up,ty>>up));
+                        if(!c) continue;
+                        SDL_Rect sr={(px>>up)-(tx>>up)*TILE,(py>>up)-(ty>>up)*TILE,std::max(1,pw>>up),std::max(1,ph>>up)};
+                        blit(c,&sr,dst);
+                        break;
+                    }
+                }
+            }
+            SDL_SetClipRect(surf,nullptr);
+        }
+        Draw::drawSunkenBorder(surf,0,0,rect.w,rect.h);
+        // Only this frame's misses are worth decoding. Nearest the centre goes
+        // last since the worker pops from the back.
+        double cx=tx0+(tx1-tx0)*0.5, cy=ty0+(ty1-ty0)*0.5;
+        std::sort(misses.begin(),misses.end(),[&](uint64_t a, uint64_t b){
+            return std::fabs(tileX(a)-cx)+std::fabs(tileY(a)-cy)>std::fabs(tileX(b)-cx)+std::fabs(tileY(b)-cy);
+        });
+        bool wanted;
+        {
+            std::lock_guard<std::mutex> lk(qMtx);
+            requests.swap(misses);
+            wanted=!requests.empty();
+        }
+        if(wanted) qCv.notify_one();
+        evict();
+    }
+
+    bool focusable() const override { return true; }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override {
+        if(!enabled) return false;
+        int lx=e.mx-rect.x, ly=e.my-rect.y;
+        if(e.type==EventType::MouseWheel){
+            zoomAbout(zoom*(e.wheel>0?1.25:0.8),lx,ly);
+            return true;
+        }
+        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+            ctx.setFocus(this);
+            dragging=true; dragX=e.mx; dragY=e.my; dragPanX=panX; dragPanY=panY;
+            return true;
+        }
+        if(e.type==EventType::MouseMove && dragging){
+            panX=dragPanX-(e.mx-dragX)/zoom; panY=dragPanY-(e.my-dragY)/zoom;
+            clampPan(); markDirty(); return true;
+        }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
+        if(e.type==EventType::DblClick){ fitToView(); return true; }
+        if(e.type==EventType::KeyDown && focused){
+            switch(e.key){
+            case SDLK_PLUS: case SDLK_EQUALS: case SDLK_KP_PLUS: setZoom(zoom*1.25); return true;
+            case SDLK_MINUS: case SDLK_KP_MINUS: setZoom(zoom*0.8); return true;
+            case SDLK_0: setZoom(1.0); return true;
+            case SDLK_HOME: fitToView(); return true;
+            default: break;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Level { int w, h; std::vector<uint32_t> px; };   // px is empty for level 0
+    struct Tile  { SDL_Surface* s; unsigned frame; std::list<uint64_t>::iterator pos; };
+
+    // Source and pyramid: written by the worker, read by the UI once `ready` covers them
+    SDL_Surface*       src=nullptr;
+    MappedFile         map;
+    RawFormat          rawFmt=RawFormat::ARGB8888;
+    size_t             rawOff=0, rawStride=0;
+    int                srcW=0, srcH=0;
+    std::vector<Level> levels;
+    std::atomic<int>   ready{0};        // levels usable so far
+    std::atomic<int>   status{(int)ImageState::Empty};
+
+    // Worker and tile queue
+    std::thread             worker;
+    std::atomic<bool>       stop{false};
+    std::mutex              qMtx;
+    std::condition_variable qCv;
+    std::vector<uint64_t>   requests, misses;
+    std::vector<std::pair<uint64_t,SDL_Surface*>> made;
+
+    // Tile cache (UI thread only)
+    std::unordered_map<uint64_t,Tile> tiles;
+    std::list<uint64_t> lru;            // front = most recently drawn
+    size_t   bytes=0;
+    unsigned frame=0;
+
+    bool   fitPending=false, dragging=false;
+    int    dragX=0, dragY=0;
+    double dragPanX=0.0, dragPanY=0.0;
+
+    static uint64_t tileKey(int L, int tx, int ty){ return ((uint64_t)L<<48)|((uint64_t)ty<<24)|(uint64_t)tx; }
+    static int tileL(uint64_t k){ return (int)(k>>48); }
+    static int tileY(uint64_t k){ return (int)((k>>24)&0xFFFFFF); }
+    static int tileX(uint64_t k){ return (int)(k&0xFFFFFF); }
+
+    // ── UI thread ─────────────────────────────────────────────────────────
+    void startLoad(std::function<bool()> decode){
+        stopWorker(); resetImage();
+        status=(int)ImageState::Loading;
+        fitPending=fitOnLoad;
+        markDirty();
+        worker=std::thread([this,decode]{
+            if(!decode()){ status=(int)ImageState::Failed; postInvalidate(); return; }
+            levels.clear();
+            int w=srcW, h=srcH;
+            levels.push_back(Level{w,h,{}});
+            while(w>TILE||h>TILE){ w=(w+1)/2; h=(h+1)/2; levels.push_back(Level{w,h,{}}); }
+            ready.store(1,std::memory_order_release);
+            postInvalidate();
+            buildPyramid();
+            if(stop) return;
+            status=(int)ImageState::Ready;
+            postInvalidate();
+            for(;;){
+                {
+                    std::unique_lock<std::mutex> lk(qMtx);
+                    qCv.wait(lk,[this]{ return stop||!requests.empty(); });
+                    if(stop) return;
+                }
+                serveRequests();
+            }
+        });
+    }
+
+    void stopWorker(){
+        {
+            std::lock_guard<std::mutex> lk(qMtx);
+            stop=true;
+        }
+        qCv.notify_all();
+        if(worker.joinable()) worker.join();
+        stop=false;
+    }
+
+    // Worker must be stopped
+    void resetImage(){
+        for(auto& t: tiles) SDL_FreeSurface(t.second.s);
+        for(auto& m: made) SDL_FreeSurface(m.second);
+        tiles.clear(); lru.clear(); made.clear(); requests.clear(); bytes=0;
+        if(src){ SDL_FreeSurface(src); src=nullptr; }
+        map.close();
+        levels.clear();
+        srcW=srcH=0;
+        ready=0;
+        status=(int)ImageState::Empty;
+    }
+
+    void adoptTiles(){
+        std::vector<std::pair<uint64_t,SDL_Surface*>> in;
+        {
+            std::lock_guard<std::mutex> lk(qMtx);
+            in.swap(made);
+        }
+        for(auto& m: in){
+            if(tiles.count(m.first)){ SDL_FreeSurface(m.second); continue; }
+            lru.push_front(m.first);
+            tiles[m.first]=Tile{m.second,frame,lru.begin()};
+            bytes+=(size_t)m.second->pitch*m.second->h;
+        }
+    }
+
+    SDL_Surface* lookup(uint64_t k){
+        auto it=tiles.find(k);
+        if(it==tiles.end()) return nullptr;
+        lru.splice(lru.begin(),lru,it->second.pos);
+        it->second.frame=frame;
+        return it->second.s;
+    }
+
+    // Drops least recently drawn tiles, never the ones on screen
+    void evict(){
+        while(bytes>cacheBudget&&!lru.empty()){
+            auto it=tiles.find(lru.back());
+            if(it->second.frame==frame) break;
+            bytes-=(size_t)it->second.s->pitch*it->second.s->h;
+            SDL_FreeSurface(it->second.s);
+            tiles.erase(it);
+            lru.pop_back();
+        }
+    }
+
+    void blit(SDL_Surface* t, const SDL_Rect* sr, SDL_Rect dst){
+        int sw=sr?sr->w:t->w, sh=sr?sr->h:t->h;
+        if(dst.w==sw&&dst.h==sh) SDL_BlitSurface(t,sr,surf,&dst);
+        else SDL_BlitScaled(t,sr,surf,&dst);
+    }
+
+    void fit(){
+        int w=imageWidth(), h=imageHeight();
+        if(!w||!h) return;
+        zoom=std::min(1.0,std::min((double)(rect.w-4)/w,(double)(rect.h-4)/h));
+        clampPan();
+    }
+
+    void zoomAbout(double z, int lx, int ly){
+        z=std::max(minZoom(),std::min(32.0,z));
+        double ix=panX+lx/zoom, iy=panY+ly/zoom;
+        zoom=z; panX=ix-lx/zoom; panY=iy-ly/zoom;
+        clampPan(); markDirty();
+    }
+
+    double minZoom() const {
+        int w=imageWidth(), h=imageHeight();
+        if(!w||!h) return 1.0/64;
+        return std::min(1.0,0.25*std::min((double)rect.w/w,(double)rect.h/h));
+    }
+
+    // Centres an image smaller than the view, otherwise keeps it covering the view
+    void clampPan(){
+        auto axis=[](double& p, double view, int img){
+            if(img<=view) p=-(view-img)*0.5;
+            else p=std::max(0.0,std::min(p,img-view));
+        };
+        axis(panX,rect.w/zoom,imageWidth());
+        axis(panY,rect.h/zoom,imageHeight());
+    }
+
+    // ── Worker thread ─────────────────────────────────────────────────────
+    // Row y of level L as ARGB; scratch is used when the source needs converting
+    const uint32_t* row(int L, int y, uint32_t* scratch) const {
+        if(L>0) return &levels[L].px[(size_t)y*levels[L].w];
+        if(src) return (const uint32_t*)((const uint8_t*)src->pixels+(size_t)y*src->pitch);
+        const uint8_t* p=map.data()+rawOff+(size_t)y*rawStride;
+        int w=srcW;
+        switch(rawFmt){
+        case RawFormat::ARGB8888: std::memcpy(scratch,p,(size_t)w*4); break;
+        case RawFormat::RGB24:
+            for(int x=0;x<w;x++,p+=3) scratch[x]=0xFF000000u|((uint32_t)p[0]<<16)|((uint32_t)p[1]<<8)|p[2];
+            break;
+        case RawFormat::Gray8:
+            for(int x=0;x<w;x++) scratch[x]=0xFF000000u|(uint32_t)p[x]*0x010101u;
+            break;
+        }
+        return scratch;
+    }
+
+    // Per-channel average of four ARGB pixels, two channels per 32-bit add
+    static uint32_t avg4(uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+        uint32_t rb=((a&0xFF00FF)+(b&0xFF00FF)+(c&0xFF00FF)+(d&0xFF00FF)+0x20002)>>2;
+        uint32_t ag=(((a>>8)&0xFF00FF)+((b>>8)&0xFF00FF)+((c>>8)&0xFF00FF)+((d>>8)&0xFF00FF)+0x20002)>>2;
+        return (rb&0xFF00FF)|((ag&0xFF00FF)<<8);
+    }
+
+    // 2x2 box filter, level by level. Tile requests are served between rows
+    // so the visible part of an already usable level does not wait.
+    void buildPyramid(){
+        std::vector<uint32_t> s0((size_t)srcW), s1((size_t)srcW);
+        for(size_t L=1;L<levels.size();L++){
+            Level& d=levels[L];
+            const Level& s=levels[L-1];
+            d.px.resize((size_t)d.w*d.h);
+            for(int y=0;y<d.h;y++){
+                if(stop) return;
+                const uint32_t* r0=row((int)L-1,2*y,s0.data());
+                const uint32_t* r1=row((int)L-1,std::min(2*y+1,s.h-1),s1.data());
+                uint32_t* o=&d.px[(size_t)y*d.w];
+                int x=0;
+                for(;2*x+1<s.w;x++) o[x]=avg4(r0[2*x],r0[2*x+1],r1[2*x],r1[2*x+1]);
+                if(x<d.w) o[x]=avg4(r0[2*x],r0[2*x],r1[2*x],r1[2*x]);
+                if((y&63)==63) serveRequests();
+            }
+            ready.store((int)L+1,std::memory_order_release);
+            postInvalidate();
+        }
+    }
+
+    SDL_Surface* makeTile(uint64_t k){
+        int L=tileL(k), px=tileX(k)*TILE, py=tileY(k)*TILE;
+        const Level& lv=levels[L];
+        int w=lv.w-px<TILE?lv.w-px:TILE, h=lv.h-py<TILE?lv.h-py:TILE;
+        SDL_Surface* t=SDL_CreateRGBSurface(0,w,h,32,0x00FF0000,0x0000FF00,0x000000FF,0xFF000000);
+        if(!t) return nullptr;
+        SDL_SetSurfaceBlendMode(t,SDL_BLENDMODE_NONE);
+        std::vector<uint32_t> scratch(L?0:(size_t)srcW);
+        for(int y=0;y<h;y++)
+            std::memcpy((uint8_t*)t->pixels+(size_t)y*t->pitch,row(L,py+y,scratch.data())+px,(size_t)w*4);
+        return t;
+    }
+
+    void serveRequests(){
+        bool any=false;
+        for(;;){
+            uint64_t k;
+            {
+                std::lock_guard<std::mutex> lk(qMtx);
+                if(stop||requests.empty()) break;
+                k=requests.back(); requests.pop_back();
+            }
+            if(tileL(k)>=ready.load(std::memory_order_acquire)) continue;
+            SDL_Surface* t=makeTile(k);
+            if(!t) continue;
+            std::lock_guard<std::mutex> lk(qMtx);
+            made.push_back(std::make_pair(k,t));
+            any=true;
+        }
+        if(any) postInvalidate();
+    }
+};
+
+// ─── Layout helpers ───────────────────────────────────────────────────────────
+namespace Layout {
+
+// Adds up to `amount` to `delta`, shared by weight; item i takes at most
+// room[i] and what it can't take goes to the others.
+inline void distribute(std::vector<int>& delta, const std::vector<float>& weight,
+                       std::vector<int> room, int amount){
+    while(amount>0){
+        float total=0.f;
+        for(size_t i=0;i<delta.size();i++) if(weight[i]>0.f&&room[i]>0) total+=weight[i];
+        if(total<=0.f) return;
+        // cumulative rounding so the shares add up exactly
+        float acc=0.f; int given=0, left=amount;
+        for(size_t i=0;i<delta.size();i++){
+            if(weight[i]<=0.f||room[i]<=0) continue;
+            acc+=weight[i];
+            int share=(int)std::lround(amount*acc/total)-given;
+            given+=share;
+            int take=std::min(share,room[i]);
+            delta[i]+=take; room[i]-=take; left-=take;
+        }
+        if(left==amount) return;
+        amount=left;
+    }
+}
+
+// Size and offset of an item within `avail` pixels on one axis
+inline void place(Align a, int avail, int want, int mn, int mx, int& size, int& off){
+    if(a==Align::Stretch) size=std::max(mn,std::min(avail,mx));
+    else size=std::max(mn,std::min(want,avail));
+    off=a==Align::Center?(avail-size)/2:a==Align::End?avail-size:0;
+}
+
+} // namespace Layout
+
+// ─── UIBox ────────────────────────────────────────────────────────────────────
+// Lays children out in a row (or a column when `vertical`). Each child gets
+// its measured size on the main axis; spare space is shared by hint.grow up
+// to the child's max, and a shortfall is taken back down to each minimum.
+// hint.align places children on the cross axis; hidden ones take no space.
+// Arranging is skipped unless the box was resized or something inside it
+// called invalidateLayout(), and children whose rect ends up unchanged keep
+// their surfaces.
+class UIBox : public UIComponent {
+public:
+    bool vertical=false;
+    int  gap=4;
+    int  padding=0;
+
+    UIBox(const std::string& id_, Rect r) : UIComponent(id_,r) {}
+
+    Size measure() override {
+        if(!measureDirty) return measured;
+        int main=0, cross=0, n=0;
+        for(auto& ch: children){
+            if(!ch->visible) continue;
+            Size s=ch->measure();
+            main+=vertical?s.h:s.w;
+            cross=std::max(cross,vertical?s.w:s.h);
+            n++;
+        }
+        if(n) main+=gap*(n-1);
+        Size s=vertical?Size(cross+padding*2,main+padding*2):Size(main+padding*2,cross+padding*2);
+        if(hint.prefW>=0) s.w=hint.prefW;
+        if(hint.prefH>=0) s.h=hint.prefH;
+        measured=clampToHint(s);
+        measureDirty=false;
+        return measured;
+    }
+
+    void arrange(Rect r) override {
+        bool resized=r.w!=rect.w||r.h!=rect.h;
+        setRect(r);
+        if(resized||layoutDirty) layoutChildren();
+        layoutDirty=false;
+    }
+
+    void onDraw() override { Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor); }
+
+private:
+    Size measured;
+
+    void layoutChildren(){
+        std::vector<UIComponent*> items;
+        std::vector<int> size, want, room;
+        std::vector<float> grow;
+        for(auto& ch: children){
+            if(!ch->visible) continue;
+            Size s=ch->measure();
+            items.push_back(ch.get());
+            size.push_back(vertical?s.h:s.w);
+            want.push_back(vertical?s.w:s.h);
+            grow.push_back(ch->hint.grow);
+        }
+        int n=(int)items.size();
+        if(!n) return;
+        int innerMain=(vertical?rect.h:rect.w)-padding*2-gap*(n-1);
+        int innerCross=(vertical?rect.w:rect.h)-padding*2;
+        int used=0;
+        for(int v: size) used+=v;
+        std::vector<int> delta(n,0);
+        room.resize(n);
+        if(used<innerMain){
+            for(int i=0;i<n;i++) room[i]=(vertical?items[i]->hint.maxH:items[i]->hint.maxW)-size[i];
+            Layout::distribute(delta,grow,room,innerMain-used);
+            for(int i=0;i<n;i++) size[i]+=delta[i];
+        } else if(used>innerMain){
+            std::vector<float> w(n);
+            for(int i=0;i<n;i++){
+                room[i]=std::max(0,size[i]-(vertical?items[i]->hint.minH:items[i]->hint.minW));
+                w[i]=(float)room[i];
+            }
+            Layout::distribute(delta,w,room,used-innerMain);
+            for(int i=0;i<n;i++) size[i]-=delta[i];
+        }
+        int pos=padding;
+        for(int i=0;i<n;i++){
+            const LayoutHint& h=items[i]->hint;
+            int cs, off;
+            Layout::place(h.align,innerCross,want[i],vertical?h.minW:h.minH,vertical?h.maxW:h.maxH,cs,off);
+            off+=padding;
+            items[i]->arrange(vertical?Rect(off,pos,cs,size[i]):Rect(pos,off,size[i],cs));
+            pos+=size[i]+gap;
+        }
+    }
+};
+
+// ─── UIGrid ───────────────────────────────────────────────────────────────────
+// Column and row tracks are a fixed number of pixels, or 0 to fit the largest
+// single-span child in them; space left over goes to tracks by grow weight.
+// Children choose their cell with hint.col/row (and colSpan/rowSpan) and sit
+// in it according to hint.align. Caching works as in UIBox.
+class UIGrid : public UIComponent {
+public:
+    struct Track {
+        int size; float grow;
+        Track(int s=0, float g=0.f): size(s), grow(g) {}
+    };
+    std::vector<Track> cols, rows;
+    int gap=4;
+    int padding=0;
+
+    UIGrid(const std::string& id_, Rect r) : UIComponent(id_,r) {}
+
+    void setColumns(std::vector<Track> t){ cols=std::move(t); invalidateLayout(); }
+    void setRows(std::vector<Track> t){ rows=std::move(t); invalidateLayout(); }
+
+    Size measure() override {
+        if(!measureDirty) return measured;
+        fitTracks(cols,colW,true);
+        fitTracks(rows,rowH,false);
+        Size s(span(colW)+padding*2,span(rowH)+padding*2);
+        if(hint.prefW>=0) s.w=hint.prefW;
+        if(hint.prefH>=0) s.h=hint.prefH;
+        measured=clampToHint(s);
+        measureDirty=false;
+        return measured;
+    }
+
+    void arrange(Rect r) override {
+        bool resized=r.w!=rect.w||r.h!=rect.h;
+        setRect(r);
+        if(resized||layoutDirty) layoutChildren();
+        layoutDirty=false;
+    }
+
+    void onDraw() override { Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor); }
+
+private:
+    Size measured;
+    std::vector<int> colW, rowH;   // content-fitted track sizes
+
+    int span(const std::vector<int>& v) const {
+        int t=0;
+        for(int x: v) t+=x;
+        return v.empty()?0:t+gap*((int)v.size()-1);
+    }
+
+    static int clampIdx(int i, size_t n){ return std::max(0,std::min(i,(int)n-1)); }
+
+    void fitTracks(const std::vector<Track>& def, std::vector<int>& out, bool horiz){
+        size_t n=std::max<size_t>(1,def.size());
+        out.assign(n,0);
+        for(size_t i=0;i<def.size();i++) out[i]=def[i].size;
+        for(auto& ch: children){
+            if(!ch->visible) continue;
+            const LayoutHint& h=ch->hint;
+            if((horiz?h.colSpan:h.rowSpan)!=1) continue;
+            int i=clampIdx(horiz?h.col:h.row,n);
+            if(i<(int)def.size()&&def[i].size>0) continue;
+            Size s=ch->measure();
+            out[i]=std::max(out[i],horiz?s.w:s.h);
+        }
+    }
+
+    // Offsets of each track start after sharing out the leftover space
+    void stretch(const std::vector<Track>& def, const std::vector<int>& fit, int avail,
+                 std::vector<int>& size, std::vector<int>& start) const {
+        size=fit;
+        int n=(int)size.size();
+        int extra=avail-span(size);
+        if(extra>0){
+            std::vector<float> w(n,0.f);
+            for(int i=0;i<n&&i<(int)def.size();i++) w[i]=def[i].grow;
+            std::vector<int> delta(n,0);
+            Layout::distribute(delta,w,std::vector<int>(n,INT_MAX),extra);
+            for(int i=0;i<n;i++) size[i]+=delta[i];
+        }
+        start.resize(n);
+        int p=padding;
+        for(int i=0;i<n;i++){ start[i]=p; p+=size[i]+gap; }
+    }
+
+    void layoutChildren(){
+        measure();
+        std::vector<int> cw, cx, rh, ry;
+        stretch(cols,colW,rect.w-padding*2,cw,cx);
+        stretch(rows,rowH,rect.h-padding*2,rh,ry);
+        for(auto& ch: children){
+            if(!ch->visible) continue;
+            const LayoutHint& h=ch->hint;
+            int c0=clampIdx(h.col,cw.size()), c1=clampIdx(h.col+std::max(1,h.colSpan)-1,cw.size());
+            int r0=clampIdx(h.row,rh.size()), r1=clampIdx(h.row+std::max(1,h.rowSpan)-1,rh.size());
+            int cellW=cx[c1]+cw[c1]-cx[c0], cellH=ry[r1]+rh[r1]-ry[r0];
+            Size s=ch->measure();
+            int w,h2,ox,oy;
+            Layout::place(h.align,cellW,s.w,h.minW,h.maxW,w,ox);
+            Layout::place(h.align,cellH,s.h,h.minH,h.maxH,h2,oy);
+            ch->arrange(Rect(cx[c0]+ox,ry[r0]+oy,w,h2));
+        }
+    }
+};
+
+// ─── UIDockSpace ──────────────────────────────────────────────────────────────
+// Docking workspace: panes (any widget) live in tabbed groups arranged by a
+// binary split tree, with draggable splitter bars between siblings. The tree
+// round-trips through a small text form, e.g.
+//   split h 0.78 { split v 0.8 { tabs 0 vp_persp vp_top } { tabs 0 timeline } } { tabs 0 cmd }
+// ("h" puts the two halves side by side, "v" stacks them; the number after
+// "tabs" is the active tab). While a splitter is dragged only the split's
+// subtree is laid out again, and its panes are previewed by stretching their
+// cached surfaces; their rects (and surfaces) are updated on release.
+class UIDockSpace : public UIComponent {
+public:
+    enum { SPLIT=4, TAB_H=20 };
+    int  minPane=40;        // px a splitter leaves on either side
+    bool alwaysTabs=false;  // tab strip even on single-pane groups
+
+    UIDockSpace(const std::string& id_, Rect r) : UIComponent(id_,r), root(new Node) {}
+
+    // New panes join the first group as tabs until loadLayout() places them
+    UIComponent* addPane(std::unique_ptr<UIComponent> w, const std::string& title, UIContext& ctx){
+        w->visible=false;
+        UIComponent* p=addChild(std::move(w),ctx);
+        panes.push_back(Pane{p,title});
+        Node* g=root.get();
+        while(g->split) g=g->a.get();
+        g->panes.push_back(p);
+        invalidateLayout();
+        return p;
+    }
+
+    std::string saveLayout() const { std::string s; save(root.get(),s); return s; }
+
+    // Replaces the tree; returns false (keeping the old one) on a syntax error.
+    // Unknown pane ids are skipped and panes left out are hidden.
+    bool loadLayout(const std::string& text){
+        std::vector<std::string> tok;
+        std::string cur;
+        for(char ch: text){
+            if(ch=='{'||ch=='}'||std::isspace((unsigned char)ch)){
+                if(!cur.empty()){ tok.push_back(cur); cur.clear(); }
+                if(ch=='{'||ch=='}') tok.push_back(std::string(1,ch));
+            } else cur+=ch;
+        }
+        if(!cur.empty()) tok.push_back(cur);
+        size_t i=0;
+        placed.clear();
+        std::unique_ptr<Node> n=parse(tok,i);
+        if(!n||i!=tok.size()) return false;
+        root=std::move(n);
+        for(auto& p: panes) p.w->setVisible(false);
+        invalidateLayout();
+        markDirty();
+        return true;
+    }
+
+    // Moves a pane into the group holding `targetId`, as its active tab
+    bool movePane(const std::string& paneId, const std::string& targetId){
+        UIComponent* w=findPane(paneId);
+        Node* to=groupOf(root.get(),findPane(targetId));
+        if(!w||!to) return false;
+        moveToGroup(w,to);
+        return true;
+    }
+
+    void arrange(Rect r) override {
+        bool resized=r.w!=rect.w||r.h!=rect.h;
+        setRect(r);
+        if(resized||layoutDirty){
+            layout(root.get(),Rect(0,0,rect.w,rect.h));
+            apply(root.get());
+            markDirty();
+        }
+        layoutDirty=false;
+    }
+
+    void onDraw() override {
+        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::FACE);
+        drawNode(root.get());
+    }
+
+    void render() override {
+        ensureSurf();
+        if(!dirty) return;
+        onDraw();
+        for(auto& ch: children){
+            if(!ch->visible) continue;
+            if(const Rect* pv=previewOf(ch.get())){
+                SDL_Rect dst=pv->toSDL();
+                if(ch->surf) SDL_BlitScaled(ch->surf,nullptr,surf,&dst);
+                else Draw::fillRect(surf,pv->x,pv->y,pv->w,pv->h,ch->bgColor);
+                continue;
+            }
+            ch->render();
+            SDL_Rect dst={ch->rect.x,ch->rect.y,ch->rect.w,ch->rect.h};
+            SDL_BlitSurface(ch->surf,nullptr,surf,&dst);
+        }
+        dirty=false;
+    }
+
+    bool onEvent(const UIEvent& e, UIContext&) override {
+        int lx=e.mx-rect.x, ly=e.my-rect.y;
         if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
-            ctx.setFocus(this);
-            int bw=16, half=rect.h/2;
-            int lx=e.mx-rect.x, ly=e.my-rect.y;
-            if(lx>=rect.w-bw){
-                if(ly<half)  tryChange(+step);
-                else         tryChange(-step);
+            if(Node* s=splitterAt(root.get(),lx,ly)){
+                dragSplit=s; return true;
             }
-            return true;
+            int t;
+            if(Node* g=tabAt(root.get(),lx,ly,t)){
+                if(g->active!=t){ g->active=t; apply(g); markDirty(); }
+                dragTab=g->panes[t]; dragX=lx; dragY=ly;
+                return true;
+            }
+            return false;
         }
-        if(e.type==EventType::MouseWheel && focused){
-            tryChange(e.wheel*step); return true;
+        if(e.type==EventType::MouseMove && dragSplit){
+            Node* s=dragSplit;
+            float span=(float)((s->vertical?s->r.h:s->r.w)-SPLIT);
+            float pos=(float)((s->vertical?ly-s->r.y:lx-s->r.x)-SPLIT/2);
+            if(span>0){
+                s->ratio=std::max(0.f,std::min(1.f,pos/span));
+                preview.clear();
+                layout(s,s->r);
+                collectPreview(s);
+                markDirty();
+            }
+            return true;
         }
-        if(e.type==EventType::KeyDown && focused){
-            if(e.key==SDLK_UP)   { tryChange(+step); return true; }
-            if(e.key==SDLK_DOWN) { tryChange(-step); return true; }
+        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){
+            if(dragSplit){
+                preview.clear();
+                apply(dragSplit);
+                dragSplit=nullptr;
+                markDirty();
+                return true;
+            }
+            if(dragTab){
+                UIComponent* w=dragTab; dragTab=nullptr;
+                if(std::abs(lx-dragX)+std::abs(ly-dragY)>4){
+                    Node* to=groupAt(root.get(),lx,ly);
+                    if(to&&to!=groupOf(root.get(),w)) moveToGroup(w,to);
+                }
+                return true;
+            }
         }
         return false;
     }
-};
-
-// ─── UIScrollBar ──────────────────────────────────────────────────────────────
-class UIScrollBar : public UIComponent {
-public:
-    bool  horizontal=false;
-    float value=0.f;        // 0..1
-    float thumbRatio=0.2f;  // thumb/track ratio
-    bool  dragging=false;
-    int   dragStart=0;
-    float dragVal=0.f;
-
-    UIScrollBar(const std::string& id_, Rect r, bool horiz=false)
-        : UIComponent(id_,r), horizontal(horiz) {}
 
-    void setValue(float v){ v=std::max(0.f,std::min(1.f,v)); if(v!=value){value=v;markDirty();} }
-    float getValue() const { return value; }
+private:
+    struct Node {
+        bool  split=false, vertical=false;   // vertical: a above b
+        float ratio=0.5f;
+        std::unique_ptr<Node> a, b;
+        Node* up=nullptr;
+        std::vector<UIComponent*> panes;      // tab group
+        int   active=0;
+        Rect  r;                              // dockspace-local
+    };
+    struct Pane { UIComponent* w; std::string title; };
+
+    std::unique_ptr<Node> root;
+    std::vector<Pane>     panes;
+    Node*        dragSplit=nullptr;
+    UIComponent* dragTab=nullptr;
+    int          dragX=0, dragY=0;
+    std::vector<std::pair<UIComponent*,Rect>> preview;   // pane → rect while dragging
+    std::vector<UIComponent*> placed;                     // loadLayout() scratch
+
+    UIComponent* findPane(const std::string& pid) const {
+        for(auto& p: panes) if(p.w->id==pid) return p.w;
+        return nullptr;
+    }
+    const std::string& titleOf(UIComponent* w) const {
+        for(auto& p: panes) if(p.w==w) return p.title;
+        return w->id;
+    }
 
-    void onDraw() override {
-        Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::SCROLLBAR_BG);
-        int btnSz=15;
-        if(horizontal){
-            // Left button
-            Draw::fillRect(surf,0,0,btnSz,rect.h,Pal::FACE);
-            Draw::drawBevel(surf,0,0,btnSz,rect.h,true);
-            Draw::drawArrowLeft(surf,4,rect.h/2-3,5,Pal::TEXT);
-            // Right button
-            Draw::fillRect(surf,rect.w-btnSz,0,btnSz,rect.h,Pal::FACE);
-            Draw::drawBevel(surf,rect.w-btnSz,0,btnSz,rect.h,true);
-            Draw::drawArrowRight(surf,rect.w-btnSz+4,rect.h/2-3,5,Pal::TEXT);
-            // Thumb
-            int trackW=rect.w-btnSz*2;
-            int tw=std::max(15,(int)(trackW*thumbRatio));
-            int tx=btnSz+(int)((trackW-tw)*value);
-            Draw::fillRect(surf,tx,1,tw,rect.h-2,Pal::FACE);
-            Draw::drawBevel(surf,tx,1,tw,rect.h-2,true);
+    bool showTabs(const Node* n) const { return alwaysTabs||n->panes.size()>1; }
+    Rect bodyOf(const Node* n) const {
+        if(!showTabs(n)) return n->r;
+        return Rect(n->r.x,n->r.y+TAB_H,n->r.w,std::max(0,n->r.h-TAB_H));
+    }
+    int tabW(UIComponent* w) const { return Draw::textWidth(titleOf(w))+12; }
+
+    // Rects only; panes are touched by apply()
+    void layout(Node* n, Rect r){
+        n->r=r;
+        if(!n->split) return;
+        int total=n->vertical?r.h:r.w;
+        int lo=std::min(minPane,(total-SPLIT)/2), hi=total-SPLIT-lo;
+        int sa=std::max(lo,std::min(hi,(int)std::lround((total-SPLIT)*n->ratio)));
+        if(n->vertical){
+            layout(n->a.get(),Rect(r.x,r.y,r.w,sa));
+            layout(n->b.get(),Rect(r.x,r.y+sa+SPLIT,r.w,r.h-sa-SPLIT));
         } else {
-            Draw::fillRect(surf,0,0,rect.w,btnSz,Pal::FACE);
-            Draw::drawBevel(surf,0,0,rect.w,btnSz,true);
-            Draw::drawArrowUp(surf,rect.w/2-3,4,4,Pal::TEXT);
-            Draw::fillRect(surf,0,rect.h-btnSz,rect.w,btnSz,Pal::FACE);
-            Draw::drawBevel(surf,0,rect.h-btnSz,rect.w,btnSz,true);
-            Draw::drawArrowDown(surf,rect.w/2-3,rect.h-btnSz+4,4,Pal::TEXT);
-            int trackH=rect.h-btnSz*2;
-            int th=std::max(15,(int)(trackH*thumbRatio));
-            int ty2=btnSz+(int)((trackH-th)*value);
-            Draw::fillRect(surf,1,ty2,rect.w-2,th,Pal::FACE);
-            Draw::drawBevel(surf,1,ty2,rect.w-2,th,true);
+            layout(n->a.get(),Rect(r.x,r.y,sa,r.h));
+            layout(n->b.get(),Rect(r.x+sa+SPLIT,r.y,r.w-sa-SPLIT,r.h));
         }
     }
 
-    bool onEvent(const UIEvent& e, UIContext& ctx) override {
-        if(!enabled) return false;
-        int btnSz=15;
-        auto fireScroll=[&](float v){ setValue(v); UIEvent se; se.type=EventType::Scroll; se.fvalue=value; emit(se); };
-        if(e.type==EventType::MouseEnter){setState(WidgetState::Hovered);return true;}
-        if(e.type==EventType::MouseLeave){setState(WidgetState::Normal);dragging=false;return true;}
-        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
-            ctx.setFocus(this);
-            if(horizontal){
-                int lx=e.mx-rect.x;
-                if(lx<btnSz) fireScroll(std::max(0.f,value-0.1f));
-                else if(lx>rect.w-btnSz) fireScroll(std::min(1.f,value+0.1f));
-                else { dragging=true; dragStart=lx; dragVal=value; }
+    void apply(Node* n){
+        if(n->split){ apply(n->a.get()); apply(n->b.get()); return; }
+        if(n->panes.empty()) return;
+        n->active=std::max(0,std::min(n->active,(int)n->panes.size()-1));
+        for(int i=0;i<(int)n->panes.size();i++){
+            UIComponent* w=n->panes[i];
+            if(i==n->active) w->arrange(bodyOf(n));
+            w->setVisible(i==n->active);
+        }
+    }
+
+    void collectPreview(Node* n){
+        if(n->split){ collectPreview(n->a.get()); collectPreview(n->b.get()); return; }
+        if(n->panes.empty()) return;
+        UIComponent* w=n->panes[n->active];
+        Rect b=bodyOf(n);
+        if(b.x!=w->rect.x||b.y!=w->rect.y||b.w!=w->rect.w||b.h!=w->rect.h)
+            preview.push_back(std::make_pair(w,b));
+    }
+
+    const Rect* previewOf(UIComponent* w) const {
+        for(auto& p: preview) if(p.first==w) return &p.second;
+        return nullptr;
+    }
+
+    void drawNode(const Node* n){
+        if(n->split){
+            drawNode(n->a.get()); drawNode(n->b.get());
+            Rect g=n->vertical?Rect(n->r.x,n->a->r.y+n->a->r.h,n->r.w,SPLIT)
+                              :Rect(n->a->r.x+n->a->r.w,n->r.y,SPLIT,n->r.h);
+            if(n->vertical){ Draw::drawHLine(surf,g.x,g.y,g.w,Pal::LIGHT); Draw::drawHLine(surf,g.x,g.y+g.h-1,g.w,Pal::SHADOW); }
+            else           { Draw::drawVLine(surf,g.x,g.y,g.h,Pal::LIGHT); Draw::drawVLine(surf,g.x+g.w-1,g.y,g.h,Pal::SHADOW); }
+            return;
+        }
+        if(n->panes.empty()){ Draw::drawBevel(surf,n->r.x,n->r.y,n->r.w,n->r.h,false); return; }
+        if(!showTabs(n)) return;
+        int x=n->r.x;
+        for(int i=0;i<(int)n->panes.size();i++){
+            int tw=tabW(n->panes[i]);
+            if(i==n->active){
+                Draw::drawHLine(surf,x,n->r.y,tw,Pal::LIGHT);
+                Draw::drawVLine(surf,x,n->r.y,TAB_H,Pal::LIGHT);
+                Draw::drawVLine(surf,x+tw-1,n->r.y,TAB_H,Pal::SHADOW);
             } else {
-                int ly=e.my-rect.y;
-                if(ly<btnSz) fireScroll(std::max(0.f,value-0.1f));
-                else if(ly>rect.h-btnSz) fireScroll(std::min(1.f,value+0.1f));
-                else { dragging=true; dragStart=ly; dragVal=value; }
+                Draw::fillRect(surf,x,n->r.y+2,tw,TAB_H-2,Pal::SCROLLBAR_BG);
+                Draw::drawRect(surf,x,n->r.y+2,tw,TAB_H-2,Pal::SHADOW);
             }
-            return true;
+            Draw::drawText(surf,x+6,n->r.y+(TAB_H-Draw::textHeight())/2,titleOf(n->panes[i]),Pal::TEXT);
+            x+=tw;
         }
-        if(e.type==EventType::MouseMove && dragging){
-            int trackSz=(horizontal?rect.w:rect.h)-btnSz*2;
-            int thumbSz=std::max(15,(int)(trackSz*thumbRatio));
-            int travel=trackSz-thumbSz;
-            if(travel>0){
-                int delta=horizontal?(e.mx-rect.x-dragStart):(e.my-rect.y-dragStart);
-                fireScroll(std::max(0.f,std::min(1.f,dragVal+(float)delta/travel)));
+    }
+
+    Node* splitterAt(Node* n, int x, int y){
+        if(!n->split||!n->r.contains(x,y)) return nullptr;
+        Rect g=n->vertical?Rect(n->r.x,n->a->r.y+n->a->r.h,n->r.w,SPLIT)
+                          :Rect(n->a->r.x+n->a->r.w,n->r.y,SPLIT,n->r.h);
+        if(g.contains(x,y)) return n;
+        if(Node* s=splitterAt(n->a.get(),x,y)) return s;
+        return splitterAt(n->b.get(),x,y);
+    }
+
+    Node* groupAt(Node* n, int x, int y){
+        if(!n->r.contains(x,y)) return nullptr;
+        if(!n->split) return n;
+        if(Node* g=groupAt(n->a.get(),x,y)) return g;
+        return groupAt(n->b.get(),x,y);
+    }
+
+    Node* tabAt(Node* n, int x, int y, int& tab){
+        Node* g=groupAt(n,x,y);
+        if(!g||!showTabs(g)||y>=g->r.y+TAB_H) return nullptr;
+        int tx=g->r.x;
+        for(int i=0;i<(int)g->panes.size();i++){
+            int tw=tabW(g->panes[i]);
+            if(x>=tx&&x<tx+tw){ tab=i; return g; }
+            tx+=tw;
+        }
+        return nullptr;
+    }
+
+    Node* groupOf(Node* n, UIComponent* w){
+        if(!w) return nullptr;
+        if(n->split){
+            if(Node* g=groupOf(n->a.get(),w)) return g;
+            return groupOf(n->b.get(),w);
+        }
+        return std::find(n->panes.begin(),n->panes.end(),w)!=n->panes.end()?n:nullptr;
+    }
+
+    void moveToGroup(UIComponent* w, Node* to){
+        Node* from=groupOf(root.get(),w);
+        if(from==to) return;
+        if(from){
+            from->panes.erase(std::find(from->panes.begin(),from->panes.end(),w));
+            if(from->panes.empty()) collapse(from);
+        }
+        to->panes.push_back(w);
+        to->active=(int)to->panes.size()-1;
+        invalidateLayout();
+        markDirty();
+    }
+
+    // An empty group's sibling takes over their parent split
+    void collapse(Node* g){
+        Node* p=g->up;
+        if(!p) return;
+        std::unique_ptr<Node> keep=std::move(p->a.get()==g?p->b:p->a);
+        Node* gp=p->up;
+        keep->up=gp;
+        if(!gp) root=std::move(keep);
+        else (gp->a.get()==p?gp->a:gp->b)=std::move(keep);
+    }
+
+    void save(const Node* n, std::string& s) const {
+        char buf[48];
+        if(n->split){
+            std::snprintf(buf,sizeof(buf),"split %c %.4f { ",n->vertical?'v':'h',n->ratio);
+            s+=buf; save(n->a.get(),s); s+=" } { "; save(n->b.get(),s); s+=" }";
+            return;
+        }
+        std::snprintf(buf,sizeof(buf),"tabs %d",n->active);
+        s+=buf;
+        for(auto* w: n->panes){ s+=' '; s+=w->id; }
+    }
+
+    std::unique_ptr<Node> parse(const std::vector<std::string>& t, size_t& i){
+        if(i>=t.size()) return nullptr;
+        std::unique_ptr<Node> n(new Node);
+        if(t[i]=="tabs"){
+            if(++i>=t.size()) return nullptr;
+            n->active=std::atoi(t[i++].c_str());
+            for(;i<t.size()&&t[i]!="}";i++){
+                UIComponent* w=findPane(t[i]);
+                if(w&&std::find(placed.begin(),placed.end(),w)==placed.end()){
+                    n->panes.push_back(w); placed.push_back(w);
+                }
             }
-            return true;
+            return n;
         }
-        if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
-        if(e.type==EventType::MouseWheel){
-            fireScroll(std::max(0.f,std::min(1.f,value-e.wheel*0.1f))); return true;
+        if(t[i]!="split"||i+3>=t.size()) return nullptr;
+        n->split=true;
+        n->vertical=t[i+1]=="v";
+        n->ratio=std::max(0.f,std::min(1.f,(float)std::atof(t[i+2].c_str())));
+        i+=3;
+        std::unique_ptr<Node>* kids[2]={&n->a,&n->b};
+        for(auto* k: kids){
+            if(i>=t.size()||t[i]!="{") return nullptr;
+            *k=parse(t,++i);
+            if(!*k||i>=t.size()||t[i]!="}") return nullptr;
+            (*k)->up=n.get();
+            i++;
         }
-        return false;
+        return n;
     }
 };
 
@@ -1195,7 +6219,7 @@ public:
 
     void onDraw() override {
         Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor);
-        int titleW=(int)title.size()*8+4;
+        int titleW=Draw::textWidth(title)+4;
         // Border (with gap for title)
         Draw::drawHLine(surf,10,8,titleW+4,bgColor);  // erase gap
         // Draw sunken box
@@ -1284,7 +6308,7 @@ public:
         Draw::drawRect(surf,0,0,rect.w,rect.h,bc);
         if(vpActive) Draw::drawRect(surf,1,1,rect.w-2,rect.h-2,bc);
         // Label (top-left)
-        Draw::fillRect(surf,2,2,(int)viewLabel.size()*8+4,12,Color{0,0,0,128});
+        Draw::fillRect(surf,2,2,Draw::textWidth(viewLabel)+4,Draw::textHeight()+4,Color{0,0,0,128});
         Draw::drawText(surf,4,3,viewLabel,Pal::VP_LABEL);
     }
 
@@ -1317,12 +6341,12 @@ public:
 
     void onDraw() override {
         Draw::drawGradientH(surf,0,0,rect.w,rect.h,Pal::TITLE_L,Pal::TITLE_R);
-        Draw::drawText(surf,6,(rect.h-8)/2,title,Pal::SEL_TXT);
+        Draw::drawText(surf,6,(rect.h-Draw::textHeight())/2,title,Pal::SEL_TXT);
         // Close button area
         int bx=rect.w-18, by=2, bw=14, bh=rect.h-4;
         Draw::fillRect(surf,bx,by,bw,bh,Color{200,80,80});
         Draw::drawBevel(surf,bx,by,bw,bh,true);
-        Draw::drawText(surf,bx+3,by+(bh-8)/2,"x",Pal::SEL_TXT);
+        Draw::drawTextCentered(surf,bx,by,bw,bh,"x",Pal::SEL_TXT);
     }
 
     bool onEvent(const UIEvent& e, UIContext& ctx) override {
@@ -1331,26 +6355,15 @@ public:
             if(e.mx>=bx){ // close
                 UIEvent ce; ce.type=EventType::Click; ce.svalue="close"; emit(ce);
             } else {
-                dragging=true; dragOffX=e.mx-rect.x; dragOffY=e.my-rect.y;
+                // screen-space offset: the window's own space moves with it
+                dragging=true;
+                if(window){ dragOffX=e.sx-window->rect.x; dragOffY=e.sy-window->rect.y; }
             }
             ctx.setFocus(this); return true;
         }
         if(e.type==EventType::MouseMove && dragging && window){
-            int nx=e.mx-dragOffX, ny=e.my-dragOffY;
-            Rect wr=window->rect;
-            int dx=nx-wr.x, dy=ny-wr.y;
-            window->rect.x+=dx; window->rect.y+=dy;
-            // update all children rects
-            std::function<void(UIComponent*,int,int)> moveChildren;
-            moveChildren=[&](UIComponent* c, int ddx, int ddy){
-                for(auto& ch: c->children){
-                    ch->rect.x+=ddx; ch->rect.y+=ddy;
-                    moveChildren(ch.get(),ddx,ddy);
-                }
-            };
-            moveChildren(window,dx,dy);
-            window->markDirty();
-            ctx.needsRedraw=true;
+            // only the window's rect changes; its surface is re-blitted as is
+            window->moveTo(e.sx-dragOffX,e.sy-dragOffY);
             return true;
         }
         if(e.type==EventType::MouseUp && e.mbtn==SDL_BUTTON_LEFT){ dragging=false; return true; }
@@ -1371,12 +6384,12 @@ public:
         bgColor=dark?Pal::DARK_PANEL:Pal::FACE;
 
         auto tb=std::unique_ptr<UITitleBar>(new UITitleBar(id_+"_tb",
-            Rect(r.x,r.y,r.w,20),title));
+            Rect(0,0,r.w,20),title));
         tb->window=this;
         titleBar=static_cast<UITitleBar*>(addChild(std::move(tb),ctx));
 
         auto bd=std::unique_ptr<UIPanel>(new UIPanel(id_+"_body",
-            Rect(r.x,r.y+20,r.w,r.h-20),dark));
+            Rect(0,20,r.w,r.h-20),dark));
         body=static_cast<UIPanel*>(addChild(std::move(bd),ctx));
     }
 
@@ -1403,63 +6416,94 @@ struct MenuItem {
         : text(t), id(i), separator(sep), disabled(dis) {}
 };
 
+class UIMenuBar;
+
+// Popup list of MenuItems. A UIMenuBar keeps one per nesting depth and reuses
+// them, so opening a menu only swaps the item list and moves the popup.
 class UIMenuDropdown : public UIComponent {
 public:
-    std::vector<MenuItem> items;
+    enum { ITEM_H=16, SEP_H=8, SLOT=8 };
+    const std::vector<MenuItem>* items=nullptr;
     int hoveredIdx=-1;
+    int openSub=-1;              // item whose submenu is showing
+    UIMenuBar* owner=nullptr;    // menubar that pools this popup
+    int depth=0;
 
     UIMenuDropdown(const std::string& id_, Rect r, std::vector<MenuItem> its)
-        : UIComponent(id_,r), items(std::move(its)) { layer=100; }
+        : UIComponent(id_,r), own(std::move(its)) { layer=100; setItems(&own); }
+    UIMenuDropdown(const std::string& id_, Rect r)
+        : UIComponent(id_,r) { layer=100; }
+
+    // The list must outlive the popup (or the next setItems)
+    void setItems(const std::vector<MenuItem>* its){
+        items=its; hoveredIdx=openSub=-1;
+        itemY.clear(); slotItem.clear();
+        int y=0;
+        for(int i=0;i<count();i++){
+            bool sep=(*its)[i].separator;
+            int h=sep?SEP_H:ITEM_H;
+            itemY.push_back(y);
+            slotItem.insert(slotItem.end(),h/SLOT,sep?-1:i);
+            y+=h;
+        }
+        itemY.push_back(y);
+        markDirty();
+    }
+
+    int count() const { return items?(int)items->size():0; }
+    int itemTop(int i) const { return 2+itemY[i]; }   // surface-local
+
+    // Item under a surface-local y, or -1 (separators, borders)
+    int itemAt(int ly) const {
+        ly-=2;
+        if(ly<0||ly/SLOT>=(int)slotItem.size()) return -1;
+        return slotItem[ly/SLOT];
+    }
+
+    // Repaints just the rows whose highlight changed
+    void setHovered(int i){
+        if(i==hoveredIdx) return;
+        int old=hoveredIdx; hoveredIdx=i;
+        if(dirty||!surf||surf->w!=rect.w||surf->h!=rect.h){ markDirty(); return; }
+        if(old>=0) paintItem(old);
+        if(i>=0)   paintItem(i);
+        if(parent) parent->markDirty();
+        else if(context) context->needsRedraw=true;
+    }
 
     void onDraw() override {
         Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::FACE);
         Draw::drawBevel(surf,0,0,rect.w,rect.h,true);
-        int y=2;
-        for(int i=0;i<(int)items.size();i++){
-            auto& it=items[i];
-            if(it.separator){
-                Draw::drawHLine(surf,2,y+3,rect.w-4,Pal::SHADOW);
-                Draw::drawHLine(surf,2,y+4,rect.w-4,Pal::LIGHT);
-                y+=8; continue;
-            }
-            if(i==hoveredIdx && !it.disabled){
-                Draw::fillRect(surf,2,y,rect.w-4,16,Pal::SEL_BG);
-                Draw::drawText(surf,6,y+4,it.text,Pal::SEL_TXT);
-            } else {
-                Color fg=it.disabled?Pal::DISABLED_TXT:Pal::TEXT;
-                Draw::drawText(surf,6,y+4,it.text,fg);
-            }
-            y+=16;
-        }
+        for(int i=0;i<count();i++) paintItem(i);
     }
 
-    bool onEvent(const UIEvent& e, UIContext& ctx) override {
-        if(e.type==EventType::MouseMove){
-            int ly=e.my-rect.y-2, y=0;
-            hoveredIdx=-1;
-            for(int i=0;i<(int)items.size();i++){
-                if(items[i].separator){y+=8;continue;}
-                if(ly>=y&&ly<y+16){hoveredIdx=i;break;}
-                y+=16;
-            }
-            markDirty(); return true;
-        }
-        if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
-            if(hoveredIdx>=0 && !items[hoveredIdx].disabled){
-                UIEvent ce; ce.type=EventType::MenuItemClicked;
-                ce.svalue=items[hoveredIdx].id; ce.ivalue=hoveredIdx;
-                emit(ce);
-            }
-            return true;
-        }
-        return false;
-    }
+    bool onEvent(const UIEvent& e, UIContext& ctx) override;
 
     static int calcHeight(const std::vector<MenuItem>& its){
         int h=4;
-        for(auto& it: its) h+=it.separator?8:16;
+        for(auto& it: its) h+=it.separator?SEP_H:ITEM_H;
         return h;
     }
+
+private:
+    std::vector<MenuItem> own;   // backing list when built from a vector
+    std::vector<int> itemY;      // top of each item, plus the total height
+    std::vector<int> slotItem;   // item index per 8px band
+
+    void paintItem(int i){
+        const MenuItem& it=(*items)[i];
+        int y=itemTop(i);
+        if(it.separator){
+            Draw::drawHLine(surf,2,y+3,rect.w-4,Pal::SHADOW);
+            Draw::drawHLine(surf,2,y+4,rect.w-4,Pal::LIGHT);
+            return;
+        }
+        bool hot=i==hoveredIdx&&!it.disabled;
+        Draw::fillRect(surf,2,y,rect.w-4,ITEM_H,hot?Pal::SEL_BG:Pal::FACE);
+        Color fg=hot?Pal::SEL_TXT:it.disabled?Pal::DISABLED_TXT:Pal::TEXT;
+        Draw::drawText(surf,6,y+(ITEM_H-Draw::textHeight())/2,it.text,fg);
+        if(!it.submenu.empty()) Draw::drawArrowRight(surf,rect.w-12,y+4,4,fg);
+    }
 };
 
 class UIMenuBar : public UIComponent {
@@ -1467,7 +6511,7 @@ public:
     struct Menu { std::string title; std::vector<MenuItem> items; };
     std::vector<Menu> menus;
     int openIdx=-1;
-    UIMenuDropdown* dropdown=nullptr;
+    UIMenuDropdown* dropdown=nullptr;   // top-level popup while a menu is open
 
     UIMenuBar(const std::string& id_, Rect r)
         : UIComponent(id_,r) {}
@@ -1480,20 +6524,43 @@ public:
     void onDraw() override {
         Draw::fillRect(surf,0,0,rect.w,rect.h,Pal::FACE);
         Draw::drawHLine(surf,0,rect.h-1,rect.w,Pal::SHADOW);
-        int x=2;
+        int x=2, ty=(rect.h-Draw::textHeight())/2;
         for(int i=0;i<(int)menus.size();i++){
-            int tw=(int)menus[i].title.size()*8+8;
+            int tw=titleWidth(i);
             if(i==openIdx){
                 Draw::fillRect(surf,x-1,0,tw+2,rect.h,Pal::SEL_BG);
-                Draw::drawText(surf,x+3,(rect.h-8)/2,menus[i].title,Pal::SEL_TXT);
+                Draw::drawText(surf,x+3,ty,menus[i].title,Pal::SEL_TXT);
             } else {
-                Draw::drawText(surf,x+3,(rect.h-8)/2,menus[i].title,Pal::TEXT);
+                Draw::drawText(surf,x+3,ty,menus[i].title,Pal::TEXT);
             }
             x+=tw+4;
         }
     }
 
+    int titleWidth(int i) const { return Draw::textWidth(menus[i].title)+8; }
+
+    // Title under a screen x, or -1; `tx` receives its left edge
+    int titleAt(int mx, int* tx=nullptr) const {
+        int lx=mx-rect.x, x=2;
+        for(int i=0;i<(int)menus.size();i++){
+            int tw=titleWidth(i);
+            if(lx>=x&&lx<x+tw){ if(tx) *tx=x; return i; }
+            x+=tw+4;
+        }
+        return -1;
+    }
+
+    void openMenu(int i, UIContext& ctx);
+    void closeMenu();
     bool onEvent(const UIEvent& e, UIContext& ctx) override;
+
+private:
+    friend class UIMenuDropdown;
+    std::vector<UIMenuDropdown*> pool;   // one popup per depth, registered once
+
+    void openPopup(int depth, const std::vector<MenuItem>* its, Rect anchor, bool side, UIContext& ctx);
+    void closePopups(int depth);
+    void itemHovered(UIMenuDropdown* dd, int i);
 };
 
 // ─── UIToolbar ────────────────────────────────────────────────────────────────
@@ -1511,48 +6578,89 @@ public:
         Draw::drawHLine(surf,0,0,rect.w,Pal::LIGHT);
     }
 
-    // Quick helpers to add flat buttons
+    // Quick helpers to add flat buttons; like native toolbars, they stay out of Tab order
     UIButton* addButton(const std::string& id_, int x, int w, const std::string& label,
                         UIContext& ctx){
-        auto b=std::unique_ptr<UIButton>(new UIButton(id_,Rect(rect.x+x,rect.y+2,w,rect.h-4),label));
+        auto b=std::unique_ptr<UIButton>(new UIButton(id_,Rect(x,2,w,rect.h-4),label));
         b->flat=true;
+        b->tabIndex=-1;
         return static_cast<UIButton*>(addChild(std::move(b),ctx));
     }
 };
 
 // ─── UITabPanel ───────────────────────────────────────────────────────────────
+// Pages are either existing widgets named by id, or built by a factory the
+// first time their tab is activated and kept as children of the panel.
+// Pages hidden for `releaseAfter` ms give back their surfaces (and with
+// `dropPages`, factory pages their whole tree, rebuilt on next activation).
 class UITabPanel : public UIComponent {
 public:
-    struct Tab { std::string title; std::string panelId; };
+    typedef std::function<std::unique_ptr<UIComponent>(Rect, UIContext&)> PageFactory;
+    struct Tab {
+        std::string  title;
+        std::string  panelId;        // existing widget, or empty with `build`
+        PageFactory  build;
+        UIComponent* page=nullptr;   // factory page while it exists
+        TimerId      releaseTimer=0;
+        Tab(const std::string& t, const std::string& p, PageFactory b=nullptr)
+            : title(t), panelId(p), build(std::move(b)) {}
+    };
     std::vector<Tab> tabs;
     int activeTab=0;
     int tabHeight=20;
+    uint32_t releaseAfter=0;   // ms a page stays hidden before trim; 0 = keep
+    bool dropPages=false;      // trim destroys factory pages, not just surfaces
 
     UITabPanel(const std::string& id_, Rect r) : UIComponent(id_,r) {}
 
+    int tabWidth(int i) const { return Draw::textWidth(tabs[i].title)+12; }
+
+    // Area below the strip handed to page factories (panel space)
+    Rect pageRect() const { return Rect(0,tabHeight+2,rect.w,rect.h-tabHeight-2); }
+
     void addTab(const std::string& title, const std::string& panelId, UIContext& ctx){
-        tabs.push_back({title,panelId});
+        tabs.emplace_back(title,panelId);
+        markDirty();
+    }
+
+    void addTab(const std::string& title, PageFactory build, UIContext&){
+        tabs.emplace_back(title,std::string(),std::move(build));
         markDirty();
     }
 
     void setActiveTab(int idx, UIContext& ctx){
         if(idx==activeTab||idx<0||idx>=(int)tabs.size()) return;
+        int prev=activeTab;
         activeTab=idx;
+        showPage(idx,ctx);
         // show/hide panels
         for(int i=0;i<(int)tabs.size();i++){
+            if(i==activeTab||tabs[i].build) continue;
             auto* p=ctx.findById(tabs[i].panelId);
-            if(p) p->setVisible(i==activeTab);
+            if(p) p->setVisible(false);
         }
+        hidePage(prev,ctx);
         markDirty();
         UIEvent e; e.type=EventType::ValueChanged; e.ivalue=activeTab; emit(e);
     }
 
+    // Current widget for a tab, or nullptr if it isn't built
+    UIComponent* pageOf(int i, UIContext& ctx){
+        if(tabs[i].build) return tabs[i].page;
+        return ctx.findById(tabs[i].panelId);
+    }
+
+    // Releases every hidden page now, e.g. under memory pressure
+    void trim(UIContext& ctx, bool trees=false){
+        for(int i=0;i<(int)tabs.size();i++) if(i!=activeTab) releasePage(i,ctx,trees);
+    }
+
     void onDraw() override {
         Draw::fillRect(surf,0,0,rect.w,rect.h,bgColor);
         // Tab strip
         int x=0;
         for(int i=0;i<(int)tabs.size();i++){
-            int tw=(int)tabs[i].title.size()*8+12;
+            int tw=tabWidth(i);
             bool active=(i==activeTab);
             if(active){
                 Draw::fillRect(surf,x,0,tw,tabHeight+1,Pal::FACE);
@@ -1564,7 +6672,7 @@ public:
                 Draw::fillRect(surf,x,2,tw,tabHeight-2,Pal::SCROLLBAR_BG);
                 Draw::drawRect(surf,x,2,tw,tabHeight-1,Pal::SHADOW);
             }
-            Draw::drawText(surf,x+6,(tabHeight-8)/2,tabs[i].title,Pal::TEXT);
+            Draw::drawText(surf,x+6,(tabHeight-Draw::textHeight())/2,tabs[i].title,Pal::TEXT);
             x+=tw;
         }
         // Bottom border
@@ -1576,7 +6684,7 @@ public:
         if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
             int lx=e.mx-rect.x, x=0;
             for(int i=0;i<(int)tabs.size();i++){
-                int tw=(int)tabs[i].title.size()*8+12;
+                int tw=tabWidth(i);
                 if(lx>=x&&lx<x+tw&&(e.my-rect.y)<tabHeight){
                     setActiveTab(i,ctx); return true;
                 }
@@ -1585,6 +6693,44 @@ public:
         }
         return false;
     }
+
+    // The active factory page is built on its first frame
+    void render() override {
+        if(context&&activeTab<(int)tabs.size()&&tabs[activeTab].build&&!tabs[activeTab].page)
+            showPage(activeTab,*context);
+        UIComponent::render();
+    }
+
+private:
+    void showPage(int i, UIContext& ctx){
+        Tab& t=tabs[i];
+        if(t.releaseTimer){ ctx.clearTimer(t.releaseTimer); t.releaseTimer=0; }
+        if(t.build&&!t.page){
+            auto pg=t.build(pageRect(),ctx);
+            if(pg) t.page=addChild(std::move(pg),ctx);
+        }
+        if(auto* p=pageOf(i,ctx)) p->setVisible(true);
+    }
+
+    void hidePage(int i, UIContext& ctx){
+        UIComponent* p=pageOf(i,ctx);
+        if(!p) return;
+        p->setVisible(false);
+        if(releaseAfter&&!tabs[i].releaseTimer)
+            tabs[i].releaseTimer=ctx.setTimeout(releaseAfter,[this,i,&ctx]{
+                tabs[i].releaseTimer=0;
+                releasePage(i,ctx,dropPages);
+            },this);
+    }
+
+    void releasePage(int i, UIContext& ctx, bool tree){
+        Tab& t=tabs[i];
+        if(t.releaseTimer){ ctx.clearTimer(t.releaseTimer); t.releaseTimer=0; }
+        UIComponent* p=pageOf(i,ctx);
+        if(!p) return;
+        if(tree&&t.build){ removeChild(p,ctx); t.page=nullptr; }
+        else p->releaseSurfaces();
+    }
 };
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -1614,45 +6760,125 @@ inline void UIRadioButton::activateInGroup(UIContext& ctx) {
     UIEvent ce; ce.type=EventType::CheckChanged; ce.ivalue=1; emit(ce);
 }
 
-inline bool UIMenuBar::onEvent(const UIEvent& e, UIContext& ctx) {
+inline void UIMenuBar::openMenu(int i, UIContext& ctx) {
+    if(i==openIdx) return;
+    int tx=2;
+    for(int k=0;k<i;k++) tx+=titleWidth(k)+4;
+    openIdx=i; markDirty();
+    Rect ar=absRect();
+    openPopup(0,&menus[i].items,Rect(ar.x+tx-2,ar.y,titleWidth(i),ar.h),false,ctx);
+}
+
+inline void UIMenuBar::closeMenu() {
+    closePopups(0);
+    if(openIdx>=0){ openIdx=-1; markDirty(); }
+}
+
+// Places the depth's popup below (or beside, for submenus) `anchor`, kept
+// inside the window. The popup widgets are created on first use only.
+inline void UIMenuBar::openPopup(int depth, const std::vector<MenuItem>* its, Rect anchor,
+                                 bool side, UIContext& ctx) {
+    closePopups(depth);
+    if(pool.empty())
+        on(EventType::Click,[this](UIComponent*, const UIEvent& ev){ if(ev.svalue=="close") closeMenu(); });
+    while((int)pool.size()<=depth){
+        int d=(int)pool.size();
+        auto dd=std::unique_ptr<UIMenuDropdown>(new UIMenuDropdown(
+            id+"_dd"+std::to_string(d),Rect(0,0,1,1)));
+        dd->layer=200+d; dd->owner=this; dd->depth=d; dd->visible=false;
+        dd->on(EventType::MenuItemClicked,[this](UIComponent*, const UIEvent& ev){
+            emit(ev); // bubble to menubar listeners
+            closeMenu();
+        });
+        pool.push_back(static_cast<UIMenuDropdown*>(ctx.add(std::move(dd))));
+    }
+    int w=120, h=UIMenuDropdown::calcHeight(*its);
+    for(auto& it: *its)
+        w=std::max(w,Draw::textWidth(it.text)+(it.submenu.empty()?16:28));
+    int x,y;
+    if(side){
+        x=anchor.x+anchor.w-3; y=anchor.y-2;
+        if(x+w>ctx.winW) x=std::max(0,anchor.x-w+3);
+    } else {
+        x=std::max(0,std::min(anchor.x,ctx.winW-w)); y=anchor.y+anchor.h;
+    }
+    if(side&&y+h>ctx.winH) y=std::max(0,ctx.winH-h);
+    UIMenuDropdown* dd=pool[depth];
+    dd->setRect(Rect(x,y,w,h));
+    dd->setItems(its);
+    dd->setVisible(true);
+    if(depth==0){ dropdown=dd; ctx.openMenu=this; }
+}
+
+inline void UIMenuBar::closePopups(int depth) {
+    for(int d=depth;d<(int)pool.size();d++){
+        if(!pool[d]->visible) break;
+        pool[d]->setVisible(false);
+        pool[d]->hoveredIdx=pool[d]->openSub=-1;
+    }
+    if(depth>0&&depth<=(int)pool.size()) pool[depth-1]->openSub=-1;
+    if(depth==0){
+        dropdown=nullptr;
+        if(context&&context->openMenu==this) context->openMenu=nullptr;
+    }
+}
+
+// Hovering an item with a submenu opens it; any other item closes what
+// was open below this popup.
+inline void UIMenuBar::itemHovered(UIMenuDropdown* dd, int i) {
+    if(i>=0&&i==dd->openSub) return;
+    if(dd->openSub>=0) closePopups(dd->depth+1);
+    if(i<0) return;
+    const MenuItem& it=(*dd->items)[i];
+    if(it.disabled||it.submenu.empty()||!context) return;
+    Rect a(dd->rect.x,dd->rect.y+dd->itemTop(i),dd->rect.w,UIMenuDropdown::ITEM_H);
+    openPopup(dd->depth+1,&it.submenu,a,true,*context);
+    dd->openSub=i;
+}
+
+inline bool UIMenuDropdown::onEvent(const UIEvent& e, UIContext&) {
+    if(e.type==EventType::MouseMove){
+        int i=rect.contains(e.mx,e.my)?itemAt(e.my-rect.y):-1;
+        setHovered(i);
+        if(owner) owner->itemHovered(this,i);
+        return true;
+    }
+    if(e.type==EventType::MouseLeave){
+        // keep the row that leads to an open submenu lit
+        setHovered(openSub);
+        return true;
+    }
     if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
-        int lx=e.mx-rect.x, x=2;
-        for(int i=0;i<(int)menus.size();i++){
-            int tw=(int)menus[i].title.size()*8+12;
-            if(lx>=x&&lx<x+tw){
-                if(openIdx==i){
-                    openIdx=-1; if(dropdown){ctx.remove(dropdown->id);dropdown=nullptr;}
-                } else {
-                    if(dropdown){ctx.remove(dropdown->id);dropdown=nullptr;}
-                    openIdx=i;
-                    // compute screen x
-                    int sx=rect.x+x-2;
-                    int h=UIMenuDropdown::calcHeight(menus[i].items);
-                    int maxW=120;
-                    for(auto& it: menus[i].items)
-                        maxW=std::max(maxW,(int)it.text.size()*8+16);
-                    auto dd=std::unique_ptr<UIMenuDropdown>(new UIMenuDropdown(
-                        id+"_dd",
-                        Rect(sx,rect.y+rect.h,maxW,h),
-                        menus[i].items));
-                    dd->layer=200;
-                    // wire close
-                    UIMenuBar* mb=this;
-                    dd->on(EventType::MenuItemClicked,[mb,&ctx,this](UIComponent* c, const UIEvent& ev){
-                        emit(ev); // bubble to menubar listeners
-                        openIdx=-1; dropdown=nullptr; ctx.remove(c->id);
-                    });
-                    dropdown=static_cast<UIMenuDropdown*>(ctx.add(std::move(dd)));
-                }
-                markDirty(); return true;
+        if(hoveredIdx>=0 && !(*items)[hoveredIdx].disabled){
+            if(!(*items)[hoveredIdx].submenu.empty()){
+                if(owner) owner->itemHovered(this,hoveredIdx);
+            } else {
+                UIEvent ce; ce.type=EventType::MenuItemClicked;
+                ce.svalue=(*items)[hoveredIdx].id; ce.ivalue=hoveredIdx;
+                emit(ce);
             }
-            x+=tw+4;
         }
-        // click outside menus
-        if(openIdx>=0){
-            openIdx=-1; if(dropdown){ctx.remove(dropdown->id);dropdown=nullptr;}
-            markDirty();
+        return true;
+    }
+    return false;
+}
+
+inline bool UIMenuBar::onEvent(const UIEvent& e, UIContext& ctx) {
+    if(e.type==EventType::MouseDown && e.mbtn==SDL_BUTTON_LEFT){
+        int i=titleAt(e.mx);
+        if(i>=0){
+            if(openIdx==i) closeMenu();
+            else openMenu(i,ctx);
+            return true;
         }
+        // click outside menus
+        if(openIdx>=0) closeMenu();
+    }
+    // With a menu open, sliding across the titles switches menus
+    if(e.type==EventType::MouseMove && openIdx>=0){
+        int i=titleAt(e.mx);
+        if(i>=0&&i!=openIdx) openMenu(i,ctx);
+        return true;
     }
     return false;
 }
@@ -1661,10 +6887,14 @@ inline bool UIMenuBar::onEvent(const UIEvent& e, UIContext& ctx) {
 inline void UIContext::processEvent(const SDL_Event& sdl_ev) {
     needsRedraw=true;
 
-    // Helper: dispatch to widget and its parents
+    // Helper: dispatch to a widget with mouse coords in its parent's space;
+    // sx/sy keep the screen position
     auto dispatch=[&](UIComponent* w, const UIEvent& e) -> bool {
         if(!w||!w->enabled) return false;
-        return w->onEvent(e,*this);
+        UIEvent le=e;
+        le.sx=e.mx; le.sy=e.my;
+        toLocal(w,le.mx,le.my);
+        return w->onEvent(le,*this);
     };
 
     switch(sdl_ev.type){
@@ -1682,7 +6912,13 @@ inline void UIContext::processEvent(const SDL_Event& sdl_ev) {
                 UIEvent e; e.type=EventType::MouseEnter; e.mx=mx; e.my=my;
                 dispatch(hoveredWidget,e);
             }
+            hideTooltip();
+            if(hit&&!hit->tooltip.empty()){
+                tipFor=hit;
+                tipTimer=setTimeout(tooltipDelay,[this]{ tipTimer=0; tipShown=true; needsRedraw=true; });
+            }
         }
+        if(!tipShown){ tipX=mx; tipY=my; }
         // Mouse move (for drags)
         if(pressedWidget){
             UIEvent e; e.type=EventType::MouseMove; e.mx=mx; e.my=my;
@@ -1697,8 +6933,10 @@ inline void UIContext::processEvent(const SDL_Event& sdl_ev) {
         int mx=sdl_ev.button.x, my=sdl_ev.button.y;
         UIComponent* hit=hitTest(mx,my);
         pressedWidget=hit;
-        // Close open menus if click is not on them
-        if(openMenu && hit!=openMenu){
+        hideTooltip();
+        // Close open menus if click is not on them or their popups
+        auto* popup=dynamic_cast<UIMenuDropdown*>(hit);
+        if(openMenu && hit!=openMenu && !(popup && popup->owner==openMenu)){
             UIEvent e; e.type=EventType::Click; e.svalue="close";
             openMenu->emit(e);
             openMenu=nullptr;
@@ -1725,33 +6963,30 @@ inline void UIContext::processEvent(const SDL_Event& sdl_ev) {
     case SDL_MOUSEWHEEL: {
         int mx,my; SDL_GetMouseState(&mx,&my);
         UIComponent* hit=hitTest(mx,my);
+        hideTooltip();
         UIEvent e; e.type=EventType::MouseWheel; e.mx=mx; e.my=my;
         e.wheel=sdl_ev.wheel.y;
-        dispatch(hit,e);
+        e.mod=(uint16_t)SDL_GetModState();
+        // bubble up until some container (e.g. a UIScrollView) consumes it
+        for(UIComponent* w=hit;w;w=w->parent) if(dispatch(w,e)) break;
     } break;
 
     case SDL_KEYDOWN: {
+        hideTooltip();
         UIEvent e; e.type=EventType::KeyDown;
         e.key=sdl_ev.key.keysym.sym;
         e.mod=(uint16_t)sdl_ev.key.keysym.mod;
         if(focusedWidget) dispatch(focusedWidget,e);
         // Tab navigation
-        if(sdl_ev.key.keysym.sym==SDLK_TAB && !widgets.empty()){
-            // find next focusable widget
-            std::vector<UIComponent*> focusable;
-            std::function<void(UIComponent*)> collect=[&](UIComponent* c){
-                if(c->enabled&&c->visible) focusable.push_back(c);
-                for(auto& ch: c->children) collect(ch.get());
-            };
-            for(auto& w: widgets) collect(w.get());
-            if(!focusable.empty()){
-                int ci=-1;
-                for(int i=0;i<(int)focusable.size();i++)
-                    if(focusable[i]==focusedWidget){ci=i;break;}
-                bool shift=sdl_ev.key.keysym.mod&KMOD_SHIFT;
-                ci=shift?(ci-1+(int)focusable.size()):((ci+1)%(int)focusable.size());
-                setFocus(focusable[ci]);
-            }
+        if(sdl_ev.key.keysym.sym==SDLK_TAB && !focusChain.empty()){
+            bool shift=sdl_ev.key.keysym.mod&KMOD_SHIFT;
+            FocusChain::iterator it;
+            if(focusedWidget&&focusedWidget->inFocusChain){
+                it=focusedWidget->focusPos;
+                if(shift){ if(it==focusChain.begin()) it=focusChain.end(); --it; }
+                else if(++it==focusChain.end()) it=focusChain.begin();
+            } else it=shift?std::prev(focusChain.end()):focusChain.begin();
+            setFocus(it->second);
         }
     } break;
 
@@ -1811,6 +7046,51 @@ inline std::unique_ptr<UISpinner> Spinner(const std::string& id, Rect r, float m
 inline std::unique_ptr<UIScrollBar> ScrollBar(const std::string& id, Rect r, bool horiz=false){
     return std::unique_ptr<UIScrollBar>(new UIScrollBar(id,r,horiz));
 }
+inline std::unique_ptr<UITextEditor> TextEditor(const std::string& id, Rect r, UIContext& ctx, const std::string& text=""){
+    auto p=std::unique_ptr<UITextEditor>(new UITextEditor(id,r,ctx));
+    if(!text.empty()) p->setText(text);
+    return p;
+}
+inline std::unique_ptr<UILogView> LogView(const std::string& id, Rect r, UIContext& ctx, size_t capacity=10000){
+    return std::unique_ptr<UILogView>(new UILogView(id,r,ctx,capacity));
+}
+inline std::unique_ptr<UIListView> ListView(const std::string& id, Rect r, UIContext& ctx){
+    return std::unique_ptr<UIListView>(new UIListView(id,r,ctx));
+}
+inline std::unique_ptr<UITreeView> TreeView(const std::string& id, Rect r, UIContext& ctx, TreeModel* model=nullptr){
+    auto p=std::unique_ptr<UITreeView>(new UITreeView(id,r,ctx));
+    if(model) p->setModel(model);
+    return p;
+}
+inline std::unique_ptr<UIDataGrid> DataGrid(const std::string& id, Rect r, UIContext& ctx, GridModel* model=nullptr){
+    auto p=std::unique_ptr<UIDataGrid>(new UIDataGrid(id,r,ctx));
+    if(model) p->setModel(model);
+    return p;
+}
+inline std::unique_ptr<UIScrollView> ScrollView(const std::string& id, Rect r, UIContext& ctx, int contentW=0, int contentH=0){
+    return std::unique_ptr<UIScrollView>(new UIScrollView(id,r,ctx,contentW,contentH));
+}
+inline std::unique_ptr<UIPlot> Plot(const std::string& id, Rect r, const std::string& title=""){
+    auto p=std::unique_ptr<UIPlot>(new UIPlot(id,r));
+    p->title=title;
+    return p;
+}
+inline std::unique_ptr<UIImageView> ImageView(const std::string& id, Rect r, const std::string& bmpPath=""){
+    auto p=std::unique_ptr<UIImageView>(new UIImageView(id,r));
+    if(!bmpPath.empty()) p->loadBMP(bmpPath);
+    return p;
+}
+inline std::unique_ptr<UIBox> Box(const std::string& id, Rect r, bool vertical=false){
+    auto b=std::unique_ptr<UIBox>(new UIBox(id,r));
+    b->vertical=vertical;
+    return b;
+}
+inline std::unique_ptr<UIGrid> Grid(const std::string& id, Rect r){
+    return std::unique_ptr<UIGrid>(new UIGrid(id,r));
+}
+inline std::unique_ptr<UIDockSpace> DockSpace(const std::string& id, Rect r){
+    return std::unique_ptr<UIDockSpace>(new UIDockSpace(id,r));
+}
 inline std::unique_ptr<UIGroupBox> GroupBox(const std::string& id, Rect r, const std::string& title){
     return std::unique_ptr<UIGroupBox>(new UIGroupBox(id,r,title));
 }
@@ -62,7 +62,7 @@ typedef struct {
     uint16_t    mod;        /* modificadores de teclado            */
     float       fvalue;     /* valor float (sliders, spinners)     */
     int         ivalue;     /* valor int  (checkboxes: 0/1)        */
-    const char* svalue;     /* valor string (text input)           */
+    const char* svalue;     /* valor string; solo en el callback   */
     const char* text;       /* SDL_TEXTINPUT                       */
 } WXEvent;
 
@@ -73,7 +73,7 @@ static WXEvent toWXEvent(const WXUI::UIEvent& e) {
     out.mod    = e.mod;
     out.fvalue = e.fvalue;
     out.ivalue = e.ivalue;
-    out.svalue = e.svalue.c_str();   // válido mientras dure el callback
+    out.svalue = e.svalue.c_str();   // apunta al texto del emisor: válido mientras dure el callback
     out.text   = e.text;
     return out;
 }
@@ -89,10 +89,6 @@ struct WXApp_s {
     WXEventCB   onEventCB   = nullptr;  void* onEventUD   = nullptr;
     WXFrameCB   onFrameCB   = nullptr;  void* onFrameUD   = nullptr;
     WXResizeCB  onResizeCB  = nullptr;  void* onResizeUD  = nullptr;
-
-    // Almacén de strings para svalue en callbacks de widget
-    // (necesario porque std::string::c_str() puede invalidarse)
-    std::string lastSValue;
 };
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -235,8 +231,6 @@ void wxwidget_on(WXWidget* w, WXEventType type, WXWidgetCB cb, void* userdata) {
         WXUI::EventType et = toEventType(type);
         w->ptr->on(et, [w, type](WXUI::UIComponent*, const WXUI::UIEvent& e) {
             WXEvent ce = toWXEvent(e);
-            w->textCache = e.svalue;          // mantener el string vivo
-            ce.svalue    = w->textCache.c_str();
             for (auto& entry : w->callbacks[(int)type]) {
                 if (entry.cb) entry.cb(w, &ce, entry.ud);
             }